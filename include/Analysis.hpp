@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Offline analysis of `.pos` positions, without the pbrain protocol.
+//
+// `--solve` runs the proof-number search on each position and prints
+// whether the side to move wins, loses or is still unknown within the
+// budget, with the proof line when there is one.
+//
+// `--analyze` searches each position to a fixed depth and writes one JSON
+// object per position to stdout, in input order: best move, score, depth,
+// node counts, time and principal variation, plus whether the move is one
+// of the position's EXPECT moves. Positions are shared out over a pool of
+// worker threads, each with its own single-threaded Bot.
+class Analysis {
+public:
+  enum class Mode { Solve, Analyze };
+
+  static constexpr std::size_t kDefaultSolveNodes = 5000000;
+  static constexpr long long kDefaultTimeMs = 60000;
+  static constexpr int kDefaultDepth = 6;
+
+  struct Options {
+    Mode mode = Mode::Solve;
+    std::vector<std::string> paths;
+    std::size_t nodes = 0; // 0 = the mode's default
+    long long timeMs = kDefaultTimeMs;
+    int depth = kDefaultDepth;
+    int threads = 1;
+    int hashMb = 0;
+  };
+
+  // Parses `--solve path... [--nodes N] [--time MS]` or `--analyze
+  // path... [--depth N] [--nodes N] [--threads K] [--hash MB]`; paths may
+  // be `.pos` files or directories.
+  static Options parseArgs(int argc, char **argv);
+  // Returns the process exit code: non-zero if a position failed to load.
+  static int run(const Options &options);
+
+private:
+  static int solve(const Options &options,
+                   const std::vector<std::string> &files);
+  static int analyze(const Options &options,
+                     const std::vector<std::string> &files);
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Fixed-depth search benchmark over a set of `.pos` positions. Prints
+// per-position and total nodes, NPS, time to depth and TT hit rate, plus a
+// signature hash of the moves and node counts: with one thread the
+// signature only changes when the search itself changes. The time column
+// covers the whole chooseMove() call, NPS only the main search.
+class Bench {
+public:
+  static constexpr int kDefaultDepth = 5;
+  static constexpr const char *kDefaultDirectory = "tests/bench";
+
+  struct Options {
+    std::vector<std::string> paths;
+    int depth = kDefaultDepth;
+    std::uint64_t nodes = 0;
+    int threads = 1;
+    int hashMb = 0;
+    bool symmetry = false;
+  };
+
+  // Parses `--bench [path...] [--depth N] [--nodes N] [--threads N]
+  // [--hash MB] [--symmetry]`; paths may be `.pos` files or directories.
+  static Options parseArgs(int argc, char **argv);
+  // Returns the process exit code: non-zero if a position failed to load.
+  static int run(const Options &options);
+};
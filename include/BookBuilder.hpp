@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+// Builds an OpeningBook file from game records, from self-play, or both.
+// Every move of the first `plies` plies becomes a book entry for the
+// position it was played in; repeated moves add up their weights and the
+// winner's moves count double.
+//
+// A game record file holds one game per line, moves as `x,y` separated by
+// spaces, Player One first; `#` lines are comments.
+class BookBuilder {
+public:
+  struct Options {
+    std::string output;
+    std::string records;
+    int selfPlayGames = 0;
+    int plies = 10;
+    int depth = 4;
+    int boardSize = 20;
+    int rule = 0;
+  };
+
+  // Parses `--build-book OUT [--games FILE] [--self-play N] [--plies N]
+  // [--depth N] [--size N] [--rule N]`.
+  static Options parseArgs(int argc, char **argv);
+  // Returns the process exit code.
+  static int run(const Options &options);
+};
@@ -1,20 +1,62 @@
 #pragma once
 
 #include "TimeManager.hpp"
+#include <array>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <optional>
-#include <unordered_map>
+#include <random>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "GameState.hpp"
+#include "OpeningBook.hpp"
+#include "ProofSolver.hpp"
+#include "ThreatSolver.hpp"
+#include "TranspositionTable.hpp"
 
 class Bot {
 public:
   using Move = std::pair<int, int>;
 
+  // Where per-iteration search reports go besides the log.
+  enum class SearchReport { None, Message, Debug };
+
+  // One completed iteration of the main thread.
+  struct SearchIteration {
+    int depth = 0;
+    int score = 0;
+    Move move{-1, -1};
+    std::uint64_t nodes = 0; // spent on this iteration, re-searches included
+    std::chrono::microseconds time{0}; // since the main search started
+  };
+
+  // Counters for the main search of the last chooseMove() call, summed
+  // over search threads. Times start after the threat solvers; a move found
+  // before the main search leaves everything at zero. qnodes count the
+  // quiescence search past the horizon.
+  struct SearchStats {
+    std::uint64_t nodes = 0;
+    std::uint64_t qnodes = 0;
+    std::uint64_t ttProbes = 0;
+    std::uint64_t ttHits = 0;
+    std::uint64_t ttCutoffs = 0;
+    int depth = 0;
+    int seldepth = 0;
+    int score = 0; // of the deepest iteration, from the mover's side
+    std::chrono::microseconds elapsed{0};
+    std::vector<SearchIteration> iterations;
+    // Best line of the deepest completed iteration.
+    std::vector<Move> pv;
+
+    // Node ratio of the last two iterations, 0 with fewer than two.
+    double branchingFactor() const;
+  };
+
   Bot();
   ~Bot();
 
@@ -23,28 +65,182 @@ public:
 
   void setRule(int rule);
   void setTimeoutTurnMs(int ms);
+  void setTimeoutMatchMs(long long ms);
+  void setTimeLeftMs(long long ms);
+  void setThreadCount(int count);
+  void setHashSizeMb(int mb);
+  void setMaxMemory(long long bytes);
+  // Fixed limits replace the turn timeout: the search stops after `depth`
+  // plies or once the main thread has searched `nodes` nodes (0 = no node
+  // limit). Used by the benchmark to get reproducible searches.
+  void setSearchLimits(int depth, std::uint64_t nodes);
+  const SearchStats &lastSearchStats() const;
+  void setSearchReport(SearchReport report);
+  // Keys the transposition table by the symmetry-canonical hash, so the
+  // eight rotations and reflections of a position share their entries.
+  void setSymmetricHashing(bool enabled);
+  // Opening book mapped at every START; an empty path disables the book.
+  void setBookPath(const std::string &path);
+
+  // Pondering: after our move, a background thread searches the position
+  // with the opponent to move until stopPondering(), so that the replies
+  // are already in the transposition table when TURN arrives. Whatever the
+  // reply, the next search just finds more of its tree in the table.
+  void setPondering(bool enabled);
+  void startPondering();
+  void stopPondering();
 
   bool applyOpponentMove(Move move);
   bool applyBoardMove(Move move, int player);
+  // Called once every stone of a BOARD is in. BOARD marks our stones 1, but
+  // Player One must be the side that moved first; when the opponent has the
+  // extra stone, we moved second and the colours are swapped.
+  void finishBoard();
   std::optional<Move> chooseMove() const;
   bool applyOurMove(Move move);
   bool takeback(Move move);
+  // Proof-number search of the current position within `nodeLimit` nodes
+  // and the timer's budget.
+  ProofSolver::Result solve(std::size_t nodeLimit, const TimeManager &timer);
 
   int boardSize() const;
   void setGameState(int size);
 
 private:
-  struct TranspositionEntry {
-    int depth;
+  static constexpr int kMaxThreads = 64;
+  static constexpr int kMaxPly = 64;
+  static constexpr int kMaxDepth = 20;
+
+  struct ScoredMove {
+    Move move;
+    int priority;
+    int fallback;
+  };
+
+  struct RootMove {
+    Move move;
     int score;
   };
 
+  // Per-thread search state: every thread searches its own board copy and
+  // keeps its own move ordering tables. Threads outlive a search and all
+  // their buffers are sized for the board up front, so searching allocates
+  // nothing once the threads exist.
+  struct SearchThread {
+    SearchThread(const GameState &root, int threadId)
+        : state(root.size()), id(threadId),
+          cells(root.size() * root.size()),
+          killers(kMaxPly, {Move{-1, -1}, Move{-1, -1}}),
+          history(static_cast<std::size_t>(2 * cells), 0),
+          counterMoves(static_cast<std::size_t>(cells), Move{-1, -1}),
+          moveStack(static_cast<std::size_t>(kMaxPly * cells)),
+          pvTable(static_cast<std::size_t>(kMaxPly * kMaxPly)) {
+      iterations.reserve(kMaxDepth);
+      rootList.reserve(static_cast<std::size_t>(cells));
+      pv.reserve(kMaxPly);
+      predicted.reserve(kMaxPly);
+      reset(root);
+    }
+
+    // Clears the counters and ordering tables for a search of `root`.
+    void reset(const GameState &root);
+
+    int cell(const Move &move) const {
+      return move.second * state.size() + move.first;
+    }
+
+    // The move list of the node `ply` plies below the root: one slot per
+    // cell, more than any node has candidates.
+    ScoredMove *moveList(int ply) {
+      return moveStack.data() + static_cast<std::size_t>(ply) * cells;
+    }
+
+    // Triangular PV table: row `ply` holds the best line found from the
+    // node at that ply, in columns ply to pvLength[ply] - 1.
+    void clearPv(int ply);
+    // `move` followed by the line of the child it leads to.
+    void updatePv(int ply, Move move);
+
+    GameState state;
+    int id;
+    int rootPly;
+    int cells;
+    Move bestMove{-1, -1};
+    int bestScore = 0;
+    int completedDepth = 0;
+    std::uint64_t nodes = 0;
+    std::uint64_t qnodes = 0;
+    std::uint64_t ttProbes = 0;
+    std::uint64_t ttHits = 0;
+    std::uint64_t ttCutoffs = 0;
+    int seldepth = 0;
+    TimeManager::Clock::time_point startTime;
+    std::vector<SearchIteration> iterations;
+    std::vector<std::array<Move, 2>> killers;
+    std::vector<int> history;
+    std::vector<Move> counterMoves;
+    std::vector<RootMove> rootList;
+    std::vector<ScoredMove> moveStack;
+    std::vector<Move> pvTable;
+    std::array<int, kMaxPly> pvLength{};
+    // Row 0 of the table after the last completed iteration.
+    std::vector<Move> pv;
+    // The rest of the previous turn's PV, when the game followed it, and
+    // whether the path to each ply is still on that line.
+    std::vector<Move> predicted;
+    std::array<bool, kMaxPly> onPredicted{};
+    int predictedScore = 0;
+  };
+
   int rule_ = 0;
-  std::chrono::milliseconds timeoutTurn_ = std::chrono::seconds(5);
+  int threadCount_ = 1;
+  TimeManager::Control timeControl_;
+  std::size_t hashBytes_ = TranspositionTable::kDefaultSizeMb << 20;
+  std::size_t maxMemory_ = 0;
+  int maxDepth_ = kMaxDepth;
+  std::uint64_t nodeLimit_ = 0;
+  bool fixedLimits_ = false;
+  bool symmetricHashing_ = false;
+  SearchReport searchReport_ = SearchReport::None;
+  SearchStats stats_;
+  bool ponderEnabled_ = false;
+  TimeManager ponderTimer_;
+  std::vector<std::unique_ptr<SearchThread>> searchThreads_;
+  std::vector<Move> rootMoves_;
+  // PV of the last search, the history length it started from and its
+  // score, so the next search can tell whether the game followed it.
+  std::vector<Move> expectedLine_;
+  std::size_t expectedPly_ = 0;
+  int expectedScore_ = 0;
+  std::unique_ptr<SearchThread> ponderSearch_;
+  std::thread ponderThread_;
+  std::string bookPath_;
+  OpeningBook book_;
+  std::mt19937 bookRng_{std::random_device{}()};
 
   std::unique_ptr<GameState> gameState_;
-  std::unordered_map<std::uint64_t, TranspositionEntry> transpositionTable_;
+  TranspositionTable transpositionTable_;
+  ThreatSolver threatSolver_;
+  ProofSolver proofSolver_;
+  void resizeTranspositionTable();
+  void prepareSearchThreads(int count);
   int evaluateBoard(const GameState &state, GameState::Player player) const;
-  int minimax(int depth, int alpha, int beta, bool maximizingPlayer,
-              GameState::Player iaPlayer, TimeManager &timer);
+  std::optional<Move> bookMove(GameState::Player us);
+  std::optional<Move> findThreatWin(GameState::Player us,
+                                    const TimeManager &timer);
+  std::optional<Move> findProofWin(const TimeManager &timer);
+  void searchRoot(SearchThread &thread, const std::vector<Move> &rootMoves,
+                  GameState::Player us, TimeManager &timer);
+  void ponder(SearchThread &thread, GameState::Player us);
+  void reportIteration(const SearchThread &thread) const;
+  bool followsExpectedLine() const;
+  void clearExpectedLine();
+  void rememberCutoff(SearchThread &thread, Move move, int side, int depth,
+                      int ply);
+  int quiescence(SearchThread &thread, int alpha, int beta,
+                 bool maximizingPlayer, GameState::Player iaPlayer,
+                 TimeManager &timer, int qply);
+  int minimax(SearchThread &thread, int depth, int alpha, int beta,
+              bool maximizingPlayer, GameState::Player iaPlayer,
+              TimeManager &timer);
 };
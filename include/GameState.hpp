@@ -10,11 +10,29 @@ public:
   using Move = std::pair<int, int>;
   enum class Player { None = 0, One = 1, Two = 2 };
 
+  // Line families tracked by the per-player bitboards. Stepping along
+  // (+dx, +dy) of a direction always moves one bit up in its line mask.
+  static constexpr int kDirectionCount = 4;
+  static constexpr int kDirections[kDirectionCount][2] = {
+      {1, 0}, {0, 1}, {1, 1}, {1, -1}};
+
+  // The eight rotations and reflections of the board: bit 0 swaps x and y,
+  // then bit 1 mirrors x and bit 2 mirrors y.
+  static constexpr int kSymmetryCount = 8;
+
+  // Every line must fit in a 64-bit mask; sizes outside the range are
+  // clamped.
+  static constexpr int kMinSize = 5;
+  static constexpr int kMaxSize = 64;
+
   explicit GameState(int size);
 
   int size() const;
   Player currentPlayer() const;
   const std::vector<Move> &history() const;
+  // Stones on the board, including those placed with set().
+  int stoneCount() const;
+  int stoneCount(Player player) const;
   int get(int x, int y) const;
   bool set(int x, int y, int player);
   bool is_empty(int x, int y) const;
@@ -29,23 +47,108 @@ public:
 
   void clear();
   void set(int x, int y, Player player);
+  // Gives every stone to the other player. The move history is dropped.
+  void swapColours();
 
   bool checkWin(int x, int y) const;
   bool checkWinFor(Player player) const;
   Player getWinner() const;
 
   bool willWin(int x, int y, Player player) const;
+  int countDirection(int x, int y, int dx, int dy, Player player) const;
+
+  std::uint64_t lineBits(int dir, int x, int y, Player player) const;
+  int lineOffset(int dir, int x, int y) const;
+  // Patterns::encodeWindow() of the cells around (x, y) along `dir`, seen
+  // from `player`; cells off the board count as opponent stones.
+  std::uint32_t shapeWindow(int dir, int x, int y, Player player) const;
+  // The `radius` cells on each side of (x, y) along `dir`, nearest the
+  // centre in the middle bits: `own` holds `player`'s stones, `blocked` the
+  // opponent's stones and the cells off the board.
+  void lineWindow(int dir, int x, int y, Player player, int radius,
+                  std::uint32_t &own, std::uint32_t &blocked) const;
+
+  // Sum of Patterns::scoreLine over every line, kept up to date by
+  // rescoring only the four lines through each changed cell.
+  int patternScore(Player player) const;
 
-  std::vector<Move> getLegalMoves() const;
+  // Empty cells within two steps of a stone, maintained incrementally. The
+  // returned list is restored to the exact same order by undo().
+  const std::vector<Move> &getLegalMoves() const;
   std::uint64_t zobristHash() const;
+  // What placing `player` on (x, y) XORs into zobristHash(), so a child's
+  // key is known without playing the move.
+  std::uint64_t moveHash(int x, int y, Player player) const;
+
+  Move transform(int symmetry, Move move) const;
+  static int inverseSymmetry(int symmetry);
+  // Smallest Zobrist hash over the eight symmetric images of the position,
+  // so every image gets the same key. `symmetry`, when given, receives the
+  // transform that maps this position onto the canonical one.
+  std::uint64_t canonicalHash(int *symmetry = nullptr) const;
+  // Keeps the hashes of all eight images up to date on every change, so
+  // canonicalHash() no longer scans the board. Off by default.
+  void trackSymmetries(bool enabled);
+  bool tracksSymmetries() const;
+
+  // Per-cell memo for the Renju forbidden-move check. Every change resets
+  // the entries on the four lines through the changed cell, up to
+  // kForbiddenRadius cells away, to 0 (unknown). Off by default.
+  static constexpr int kForbiddenRadius = 5;
+  void trackForbidden(bool enabled);
+  bool tracksForbidden() const;
+  std::uint8_t forbiddenCache(int x, int y) const;
+  void setForbiddenCache(int x, int y, std::uint8_t value) const;
 
 private:
   void initZobrist();
   void updateHash(int x, int y, Player oldPlayer, Player newPlayer);
-  int countDirection(int x, int y, int dx, int dy, Player player) const;
+  std::uint64_t zobristKey(int cell, Player player) const;
+  void setCell(int x, int y, Player player);
+  int lineIndex(int dir, int x, int y) const;
+  int cellIndex(int x, int y) const;
+  std::uint64_t &lineSlot(Player player, int dir, int line);
+  std::uint64_t lineSlot(Player player, int dir, int line) const;
+  void rescoreLine(int dir, int line);
+  void invalidateForbidden(int x, int y);
+  void addNeighbours(int x, int y);
+  void removeNeighbours(int x, int y);
+  // Neighbour updates compiled for a fixed board size N (15 and 20, the
+  // common tournament sizes), so the row stride is a constant; N = 0 is the
+  // generic version.
+  template <int N> void addNeighboursFor(int x, int y);
+  template <int N> void removeNeighboursFor(int x, int y);
+  void eraseCandidate(int index);
+  void insertCandidate(int index);
+
+  // The per-cell arrays (board_, candidateRefs_, candidatePos_,
+  // forbiddenCache_) are padded with kPadding wall cells on every side, so
+  // walks up to that distance from a cell need no bounds checks.
+  static constexpr int kPadding = kForbiddenRadius;
+
   int size_;
+  int stride_;
+  // Index step of one cell along each of kDirections.
+  int directionStride_[kDirectionCount];
+  int lineCount_;
   std::vector<Player> board_;
+  std::vector<std::uint64_t> lines_;
+  std::vector<int> lineFirst_;
+  std::vector<int> lineLast_;
+  std::vector<int> lineScores_;
+  int patternScore_[2] = {0, 0};
+  int stoneCount_[2] = {0, 0};
+  std::vector<std::uint8_t> candidateRefs_;
+  std::vector<int> candidatePos_;
+  std::vector<Move> candidates_;
+  std::vector<Move> openingMoves_;
   std::vector<Move> history_;
   std::vector<std::uint64_t> zobristTable_;
   std::uint64_t zobristHash_ = 0;
+  bool trackSymmetries_ = false;
+  // symmetryCells_[sym * cells + cell]: the cell `cell` maps to.
+  std::vector<int> symmetryCells_;
+  std::uint64_t symmetryHashes_[kSymmetryCount] = {};
+  bool trackForbidden_ = false;
+  mutable std::vector<std::uint8_t> forbiddenCache_;
 };
@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <optional>
 #include <string>
 
@@ -19,6 +20,8 @@ public:
 private:
     Logger() = default;
 
+    // Guards out_ and file_: the search and ponder threads log too.
+    mutable std::mutex mutex_;
     std::ostream *out_ = nullptr;
     std::optional<std::ofstream> file_;
 };
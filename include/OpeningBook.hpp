@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GameState.hpp"
+
+// Read-only opening book, memory-mapped from disk. Positions are keyed by
+// GameState::canonicalHash() and moves are stored in the canonical
+// orientation, so one entry covers all eight symmetric positions.
+//
+// File layout (little-endian): a 16-byte header "GMKB", version, board
+// size, rule, then 12-byte records {key u64, move u16 (x << 8 | y),
+// weight u16} sorted by key.
+class OpeningBook {
+public:
+  using Move = GameState::Move;
+
+  struct Entry {
+    std::uint64_t key;
+    Move move;
+    std::uint16_t weight;
+  };
+
+  OpeningBook() = default;
+  ~OpeningBook();
+  OpeningBook(const OpeningBook &) = delete;
+  OpeningBook &operator=(const OpeningBook &) = delete;
+
+  // Maps `path`; returns false (and keeps the book empty) when the file is
+  // missing or not a book.
+  bool load(const std::string &path);
+  void unload();
+
+  bool loaded() const { return records_ != nullptr; }
+  int boardSize() const { return boardSize_; }
+  int rule() const { return rule_; }
+  std::size_t entryCount() const { return count_; }
+
+  // Book moves of `state` in its own orientation, with their weights.
+  std::vector<std::pair<Move, int>> probe(const GameState &state) const;
+
+  // Sorts and writes `entries` (canonical keys and moves) as a book file.
+  static bool write(const std::string &path, int boardSize, int rule,
+                    std::vector<Entry> entries);
+
+private:
+  Entry record(std::size_t index) const;
+
+  void *mapping_ = nullptr;
+  std::size_t mappingSize_ = 0;
+  const unsigned char *records_ = nullptr;
+  std::size_t count_ = 0;
+  int boardSize_ = 0;
+  int rule_ = 0;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// Shape recognition on board lines.
+//
+// scoreLine() scores a whole line, described by the bit masks of the scored
+// player's stones and the opponent's stones plus the range of bits that lie
+// on the board. Every five-cell window free of opponent stones is weighted
+// by the number of own stones it holds: open shapes are covered by more
+// windows than closed ones, and broken shapes such as X.XX or XX.XX count
+// like their contiguous counterparts.
+//
+// shape() classifies the nine cells centred on a point along one direction,
+// assuming the centre holds an own stone. The eight surrounding cells are
+// packed two bits each (bit 0: own stone, bit 1: opponent stone or off the
+// board) by encodeWindow(), and the result comes from a table generated at
+// compile time.
+class Patterns {
+public:
+  static constexpr std::uint8_t kFive = 1 << 0;
+  static constexpr std::uint8_t kFour = 1 << 1;
+  static constexpr std::uint8_t kOpenFour = 1 << 2;
+  static constexpr std::uint8_t kFreeThree = 1 << 3;
+
+  static constexpr int kWindowRadius = 4;
+
+  static int scoreLine(std::uint64_t own, std::uint64_t opponent, int first,
+                       int last);
+
+  static std::uint32_t encodeWindow(std::uint64_t own, std::uint64_t blocked,
+                                    int pos);
+  static std::uint8_t shape(std::uint32_t window);
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+class Bot;
+
+// A test position in the `.pos` format used by tests/must_win_block:
+// `SIZE n`, `RULE n`, `EXPECT x,y ...` and `x,y,player` stone lines, with
+// `#` comments and blank lines ignored.
+struct PositionFile {
+  using Move = std::pair<int, int>;
+
+  std::string name;
+  int size = 20;
+  int rule = 0;
+  std::vector<Move> expect;
+  std::vector<std::tuple<int, int, int>> stones;
+
+  // Returns false when the file cannot be read or has a malformed line.
+  static bool load(const std::string &path, PositionFile &position);
+  // Every `.pos` file in `directory`, sorted by name so runs are repeatable.
+  static std::vector<std::string> list(const std::string &directory);
+  // Expands directories in `paths` with list(); files are kept as given.
+  static std::vector<std::string>
+  collect(const std::vector<std::string> &paths);
+
+  // Starts a game of this size and rule on `bot` and places the stones.
+  bool setUp(Bot &bot) const;
+};
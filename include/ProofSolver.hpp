@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "GameState.hpp"
+#include "ThreatSolver.hpp"
+#include "TimeManager.hpp"
+
+// Depth-first proof-number search (df-pn with the 1+epsilon threshold
+// trick). The attacker only plays fives, forced blocks, fours and moves
+// that make a free three; the defender may play every candidate move. A
+// proof is therefore exact, while a disproof only means there is no win
+// in that threat space.
+//
+// Proof and disproof numbers live in a fixed-size table of four-entry
+// buckets. When it fills up, garbage collection drops the unsolved
+// entries with the least work below them, so memory stays bounded however
+// long the search runs.
+class ProofSolver {
+public:
+  using Move = GameState::Move;
+  using LegalityCheck = ThreatSolver::LegalityCheck;
+
+  enum class Outcome { Unknown, Win, Loss };
+
+  struct Result {
+    Outcome outcome = Outcome::Unknown;
+    // Alternating moves from the side to move, ending with the five, or
+    // with the four whose only block is forbidden.
+    std::vector<Move> line;
+    std::size_t nodes = 0;
+  };
+
+  static constexpr std::size_t kDefaultSizeMb = 16;
+
+  explicit ProofSolver(std::size_t bytes = kDefaultSizeMb << 20);
+
+  void resize(std::size_t bytes);
+  std::size_t sizeBytes() const;
+
+  // Tries to prove a win for the side to move, then, with the nodes left,
+  // a win for the opponent (a loss).
+  Result solve(const GameState &state, std::size_t nodeLimit,
+               const TimeManager &timer, const LegalityCheck &legal);
+
+private:
+  struct Entry {
+    std::uint64_t key = 0;
+    std::uint32_t pn = 0;
+    std::uint32_t dn = 0;
+    std::uint32_t work = 0;
+  };
+
+  // Move lists of one ply of the search, kept between solves so that the
+  // search stops allocating once they have grown.
+  struct Ply {
+    std::vector<Move> moves;
+    std::vector<Move> blocks;
+    std::vector<std::uint64_t> keys;
+  };
+
+  bool prove(GameState::Player attacker);
+  void search(std::uint32_t thpn, std::uint32_t thdn);
+  bool expand(Ply &ply, std::uint32_t &pn, std::uint32_t &dn) const;
+  std::vector<Move> proofLine();
+
+  std::uint64_t nodeKey(std::uint64_t hash) const;
+  std::uint64_t childKey(const Move &move) const;
+  void lookup(std::uint64_t key, std::uint32_t &pn, std::uint32_t &dn) const;
+  const Entry *find(std::uint64_t key) const;
+  void store(std::uint64_t key, std::uint32_t pn, std::uint32_t dn,
+             std::size_t work);
+  void collectGarbage();
+  bool outOfBudget();
+
+  GameState state_{20};
+  GameState::Player attacker_ = GameState::Player::One;
+  std::size_t nodes_ = 0;
+  std::size_t nodeLimit_ = 0;
+  bool aborted_ = false;
+  const TimeManager *timer_ = nullptr;
+  const LegalityCheck *legal_ = nullptr;
+  std::vector<Entry> table_;
+  std::size_t bucketMask_ = 0;
+  std::size_t used_ = 0;
+  std::vector<Ply> plies_;
+  std::size_t rootPly_ = 0;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "GameState.hpp"
+
+// Renju restrictions on Player One (black): an overline, a double four or a
+// double three is forbidden, unless the move also makes exactly five.
+//
+// Each direction is classified by one lookup in a table indexed by the ten
+// cells around the move, five on each side, in base 3. A three only counts
+// when a legal move turns it into a straight four, so the rare
+// double-three candidates are settled recursively, with the stones under
+// test laid on a small overlay instead of the board. The line-local part
+// of the verdict is memoised in the GameState forbidden cache when the
+// state tracks it.
+class Renju {
+public:
+  // Recursion limit for nested three checks; deeper threes count as real.
+  static constexpr int kMaxDepth = 6;
+
+  static bool isForbidden(const GameState &state, int x, int y);
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "GameState.hpp"
+#include "TimeManager.hpp"
+
+// Threat-space search. Only forcing attacker moves are explored: fours for
+// a VCF (victory by continuous fours), fours and free threes for a VCT
+// (victory by continuous threats). The defender answers a four on its gain
+// square and a three on any empty cell of the threatened line within four
+// steps, or with a four of its own. A proof is exact under that model and
+// comes back as the alternating attacker/defender line.
+class ThreatSolver {
+public:
+  using Move = GameState::Move;
+  using LegalityCheck =
+      std::function<bool(const GameState &, int, int, GameState::Player)>;
+
+  enum class Mode { Vcf, Vct };
+
+  struct Result {
+    bool proven = false;
+    std::vector<Move> line;
+    std::size_t nodes = 0;
+  };
+
+  ThreatSolver();
+
+  // maxDepth counts attacker moves; the search deepens one move at a time
+  // up to it and gives up once nodeLimit nodes are spent or timer expires.
+  Result solve(const GameState &state, GameState::Player attacker, Mode mode,
+               int maxDepth, std::size_t nodeLimit, const TimeManager &timer,
+               const LegalityCheck &legal);
+
+private:
+  // Positions where the attacker found no win within `depth` moves. Wins
+  // are not cached since the proof line has to be rebuilt anyway.
+  struct HashEntry {
+    std::uint64_t key = 0;
+    int depth = -1;
+  };
+
+  // Move lists of one ply of the search, kept between solves so that the
+  // search stops allocating once they have grown.
+  struct Ply {
+    std::vector<Move> wins;
+    std::vector<Move> fours;
+    std::vector<Move> threes;
+    std::vector<Move> rest;
+  };
+
+  Ply &ply();
+  bool attack(int depth, std::vector<Move> &line);
+  bool defend(int depth, Move threat, std::vector<Move> &line);
+  void collectWins(GameState::Player player, std::vector<Move> &wins) const;
+  void collectThreats(std::vector<Move> &fours,
+                      std::vector<Move> &threes) const;
+  bool makesFour(Move move, GameState::Player player) const;
+  bool outOfBudget();
+  std::uint64_t hashKey() const;
+
+  GameState state_{20};
+  GameState::Player attacker_ = GameState::Player::One;
+  GameState::Player defender_ = GameState::Player::Two;
+  Mode mode_ = Mode::Vcf;
+  std::size_t nodes_ = 0;
+  std::size_t nodeLimit_ = 0;
+  bool aborted_ = false;
+  const TimeManager *timer_ = nullptr;
+  const LegalityCheck *legal_ = nullptr;
+  std::vector<HashEntry> table_;
+  std::vector<Ply> plies_;
+  int rootPly_ = 0;
+};
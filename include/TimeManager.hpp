@@ -1,21 +1,70 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 
+// Search clock shared by every search thread. The search aims for the
+// optimum time and never goes past the maximum; stop() ends the search
+// early for all threads.
 class TimeManager {
 public:
   using Clock = std::chrono::steady_clock;
 
-  void start(std::chrono::milliseconds budget) {
-    if (budget.count() < 0) {
-      budget = std::chrono::milliseconds(0);
-    }
-    deadline_ = Clock::now() + budget;
+  // Nodes between two clock reads in the search (a power of two).
+  static constexpr std::uint64_t kCheckInterval = 256;
+
+  // What the manager told us: per-move limit, whole-match limit (0 = none)
+  // and the match time still left (negative = not sent).
+  struct Control {
+    std::chrono::milliseconds turn{5000};
+    std::chrono::milliseconds match{0};
+    std::chrono::milliseconds left{-1};
+  };
+
+  struct Budget {
+    std::chrono::milliseconds optimum;
+    std::chrono::milliseconds maximum;
+  };
+
+  // Splits the time we have left over the moves we still expect to play.
+  // `stones` is the number of stones already on the board.
+  static Budget allocate(const Control &control, int stones);
+
+  void start(Budget budget);
+  void start(std::chrono::milliseconds budget) { start({budget, budget}); }
+
+  void stop() { stopped_.store(true, std::memory_order_relaxed); }
+
+  // Cheap: only reads the stop flag. The search calls it at every node.
+  bool stopped() const { return stopped_.load(std::memory_order_relaxed); }
+
+  // Reads the clock and raises the stop flag once the maximum has passed.
+  bool expired() const {
+    if (stopped())
+      return true;
+    if (Clock::now() < deadline_)
+      return false;
+    stopped_.store(true, std::memory_order_relaxed);
+    return true;
   }
 
-  bool expired() const { return Clock::now() >= deadline_; }
+  std::chrono::milliseconds elapsed() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now() - start_);
+  }
+  std::chrono::milliseconds optimum() const { return optimum_; }
+  std::chrono::milliseconds maximum() const { return maximum_; }
+
+  // Sets the optimum to `factor` times the allocated one, capped at the
+  // maximum. Used to think longer when the search looks unstable.
+  void scaleOptimum(double factor);
 
 private:
+  Clock::time_point start_ = Clock::time_point::min();
   Clock::time_point deadline_ = Clock::time_point::min();
+  std::chrono::milliseconds baseOptimum_{0};
+  std::chrono::milliseconds optimum_{0};
+  std::chrono::milliseconds maximum_{0};
+  mutable std::atomic<bool> stopped_{false};
 };
-
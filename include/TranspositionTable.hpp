@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Fixed-size transposition table. Entries live in 64-byte buckets of four,
+// indexed by the low bits of the key; the bucket count is a power of two.
+// The first three slots of a bucket keep the most valuable entries (deepest
+// and most recent), the last one is always overwritten. Each search bumps a
+// generation counter so entries left over from earlier moves age out first.
+//
+// The table is shared by all search threads without locks. A slot holds the
+// entry data and the key XORed with that data, each in its own relaxed
+// atomic word; a slot torn by concurrent writers fails the XOR check on
+// probe and reads as a miss.
+class TranspositionTable {
+public:
+  using Move = std::pair<int, int>;
+  enum class Bound : std::uint8_t { None = 0, Exact = 1, Lower = 2, Upper = 3 };
+
+  struct Entry {
+    int score = 0;
+    int depth = 0;
+    Bound bound = Bound::None;
+    Move move{-1, -1};
+  };
+
+  static constexpr std::size_t kDefaultSizeMb = 16;
+
+  TranspositionTable();
+
+  void resize(std::size_t bytes);
+  void clear();
+  void newSearch();
+
+  bool probe(std::uint64_t key, Entry &entry) const;
+  void store(std::uint64_t key, int depth, int score, Bound bound, Move move);
+
+  std::size_t sizeBytes() const;
+
+private:
+  struct Slot {
+    std::atomic<std::uint64_t> check{0};
+    std::atomic<std::uint64_t> data{0};
+  };
+
+  static constexpr int kBucketSlots = 4;
+
+  struct alignas(64) Bucket {
+    Slot slots[kBucketSlots];
+  };
+
+  std::uint64_t pack(int depth, int score, Bound bound, Move move) const;
+  int age(std::uint64_t data) const;
+
+  std::unique_ptr<Bucket[]> buckets_;
+  std::size_t bucketCount_ = 0;
+  std::uint64_t mask_ = 0;
+  std::uint8_t generation_ = 0;
+};
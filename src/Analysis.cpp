@@ -0,0 +1,213 @@
+#include "Analysis.hpp"
+#include "Bot.hpp"
+#include "PositionFile.hpp"
+#include "TimeManager.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+constexpr int kMaxWorkers = 64;
+
+const char *outcomeName(ProofSolver::Outcome outcome) {
+  switch (outcome) {
+  case ProofSolver::Outcome::Win:
+    return "win";
+  case ProofSolver::Outcome::Loss:
+    return "loss";
+  case ProofSolver::Outcome::Unknown:
+    break;
+  }
+  return "unknown";
+}
+
+std::string jsonString(const std::string &value) {
+  std::string out = "\"";
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+std::string jsonMove(const Bot::Move &move) {
+  return "[" + std::to_string(move.first) + "," +
+         std::to_string(move.second) + "]";
+}
+
+// One JSON line for a position, or an error object when it cannot be set
+// up.
+std::string analyzePosition(Bot &bot, const std::string &file) {
+  PositionFile position;
+  if (!PositionFile::load(file, position) || !position.setUp(bot)) {
+    return "{\"file\":" + jsonString(file) +
+           ",\"error\":\"cannot load position\"}";
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto chosen = bot.chooseMove();
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  const Bot::SearchStats &stats = bot.lastSearchStats();
+  const Bot::Move move = chosen.value_or(Bot::Move{-1, -1});
+
+  std::string line = "{\"file\":" + jsonString(file) +
+                     ",\"move\":" + jsonMove(move) +
+                     ",\"score\":" + std::to_string(stats.score) +
+                     ",\"depth\":" + std::to_string(stats.depth) +
+                     ",\"seldepth\":" + std::to_string(stats.seldepth) +
+                     ",\"nodes\":" + std::to_string(stats.nodes) +
+                     ",\"qnodes\":" + std::to_string(stats.qnodes) +
+                     ",\"time_ms\":" + std::to_string(elapsed.count()) +
+                     ",\"pv\":[";
+  // A move found before the main search (win, block, book, threat) is its
+  // own line.
+  const std::vector<Bot::Move> pv =
+      stats.pv.empty() && chosen ? std::vector<Bot::Move>{move} : stats.pv;
+  for (std::size_t i = 0; i < pv.size(); ++i) {
+    line += (i ? "," : "") + jsonMove(pv[i]);
+  }
+  line += "]";
+  if (!position.expect.empty()) {
+    const bool expected = std::find(position.expect.begin(),
+                                    position.expect.end(),
+                                    move) != position.expect.end();
+    line += std::string(",\"expected\":") + (expected ? "true" : "false");
+  }
+  return line + "}";
+}
+} // namespace
+
+Analysis::Options Analysis::parseArgs(int argc, char **argv) {
+  Options options;
+  bool inPaths = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const bool hasValue = i + 1 < argc;
+    try {
+      if (arg == "--solve" || arg == "--analyze") {
+        options.mode = arg == "--solve" ? Mode::Solve : Mode::Analyze;
+        inPaths = true;
+      } else if (arg == "--nodes" && hasValue) {
+        options.nodes = std::stoull(argv[++i]);
+      } else if (arg == "--time" && hasValue) {
+        options.timeMs = std::stoll(argv[++i]);
+      } else if (arg == "--depth" && hasValue) {
+        options.depth = std::stoi(argv[++i]);
+      } else if (arg == "--threads" && hasValue) {
+        options.threads = std::stoi(argv[++i]);
+      } else if (arg == "--hash" && hasValue) {
+        options.hashMb = std::stoi(argv[++i]);
+      } else if (arg == "--log" && hasValue) {
+        ++i;
+      } else if (inPaths && arg.rfind("--", 0) != 0) {
+        options.paths.push_back(arg);
+      }
+    } catch (...) {
+    }
+  }
+  return options;
+}
+
+int Analysis::run(const Options &options) {
+  const auto files = PositionFile::collect(options.paths);
+  if (files.empty()) {
+    std::fprintf(stderr, "%s: no .pos files given\n",
+                 options.mode == Mode::Solve ? "solve" : "analyze");
+    return 1;
+  }
+  return options.mode == Mode::Solve ? solve(options, files)
+                                     : analyze(options, files);
+}
+
+int Analysis::solve(const Options &options,
+                    const std::vector<std::string> &files) {
+  const std::size_t nodes = options.nodes ? options.nodes : kDefaultSolveNodes;
+  Bot bot;
+  int failures = 0;
+  for (const auto &file : files) {
+    PositionFile position;
+    if (!PositionFile::load(file, position) || !position.setUp(bot)) {
+      std::printf("%-36s  cannot load position\n", file.c_str());
+      ++failures;
+      continue;
+    }
+
+    TimeManager timer;
+    timer.start(std::chrono::milliseconds(options.timeMs));
+    const auto result = bot.solve(nodes, timer);
+    std::printf("%-36s  %-7s  nodes %10zu  time %8lld ms",
+                position.name.c_str(), outcomeName(result.outcome),
+                result.nodes,
+                static_cast<long long>(timer.elapsed().count()));
+    if (!result.line.empty()) {
+      std::printf("  line");
+      for (const auto &move : result.line) {
+        std::printf(" %d,%d", move.first, move.second);
+      }
+    }
+    std::printf("\n");
+  }
+  return failures ? 1 : 0;
+}
+
+// Workers take the next file from a shared counter. Finished lines are
+// printed as soon as every earlier line is out, so the output order does
+// not depend on the thread count.
+int Analysis::analyze(const Options &options,
+                      const std::vector<std::string> &files) {
+  const int workers = std::clamp(
+      std::min(options.threads, static_cast<int>(files.size())), 1,
+      kMaxWorkers);
+  std::vector<std::string> lines(files.size());
+  std::vector<bool> done(files.size(), false);
+  std::atomic<std::size_t> next{0};
+  std::atomic<int> failures{0};
+  std::mutex outputMutex;
+  std::size_t printed = 0;
+
+  auto work = [&] {
+    Bot bot;
+    bot.setHashSizeMb(options.hashMb);
+    bot.setSearchLimits(options.depth,
+                        static_cast<std::uint64_t>(options.nodes));
+    for (std::size_t index = next++; index < files.size(); index = next++) {
+      std::string line = analyzePosition(bot, files[index]);
+      if (line.find("\"error\"") != std::string::npos) {
+        ++failures;
+      }
+      std::lock_guard<std::mutex> lock(outputMutex);
+      lines[index] = std::move(line);
+      done[index] = true;
+      for (; printed < files.size() && done[printed]; ++printed) {
+        std::printf("%s\n", lines[printed].c_str());
+        lines[printed].clear();
+      }
+      std::fflush(stdout);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(static_cast<std::size_t>(workers - 1));
+  for (int id = 1; id < workers; ++id) {
+    pool.emplace_back(work);
+  }
+  work();
+  for (auto &thread : pool) {
+    thread.join();
+  }
+  return failures ? 1 : 0;
+}
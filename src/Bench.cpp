@@ -0,0 +1,149 @@
+#include "Bench.hpp"
+#include "Bot.hpp"
+#include "PositionFile.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+constexpr std::uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+constexpr std::uint64_t kFnvPrime = 0x100000001b3ULL;
+
+void mix(std::uint64_t &hash, std::uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    hash ^= (value >> (8 * i)) & 0xFF;
+    hash *= kFnvPrime;
+  }
+}
+
+double milliseconds(std::chrono::microseconds duration) {
+  return static_cast<double>(duration.count()) / 1000.0;
+}
+
+std::uint64_t nodesPerSecond(std::uint64_t nodes,
+                             std::chrono::microseconds elapsed) {
+  if (elapsed.count() <= 0)
+    return 0;
+  return nodes * 1000000ULL / static_cast<std::uint64_t>(elapsed.count());
+}
+
+double hitRate(std::uint64_t hits, std::uint64_t probes) {
+  return probes ? 100.0 * static_cast<double>(hits) /
+                      static_cast<double>(probes)
+                : 0.0;
+}
+
+} // namespace
+
+Bench::Options Bench::parseArgs(int argc, char **argv) {
+  Options options;
+  bool inBench = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const bool hasValue = i + 1 < argc;
+    try {
+      if (arg == "--bench") {
+        inBench = true;
+      } else if (arg == "--symmetry") {
+        options.symmetry = true;
+      } else if (arg == "--depth" && hasValue) {
+        options.depth = std::stoi(argv[++i]);
+      } else if (arg == "--nodes" && hasValue) {
+        options.nodes = std::stoull(argv[++i]);
+      } else if (arg == "--threads" && hasValue) {
+        options.threads = std::stoi(argv[++i]);
+      } else if (arg == "--hash" && hasValue) {
+        options.hashMb = std::stoi(argv[++i]);
+      } else if (arg == "--log" && hasValue) {
+        ++i;
+      } else if (inBench && arg.rfind("--", 0) != 0) {
+        options.paths.push_back(arg);
+      }
+    } catch (...) {
+    }
+  }
+  if (options.paths.empty()) {
+    options.paths.push_back(kDefaultDirectory);
+  }
+  return options;
+}
+
+int Bench::run(const Options &options) {
+  Bot bot;
+  bot.setThreadCount(options.threads);
+  bot.setHashSizeMb(options.hashMb);
+  bot.setSearchLimits(options.depth, options.nodes);
+  bot.setSymmetricHashing(options.symmetry);
+
+  const auto files = PositionFile::collect(options.paths);
+  if (files.empty()) {
+    std::fprintf(stderr, "bench: no .pos files found\n");
+    return 1;
+  }
+
+  std::printf("bench: %zu positions, depth %d, nodes %llu, threads %d\n",
+              files.size(), options.depth,
+              static_cast<unsigned long long>(options.nodes),
+              options.threads);
+
+  int failures = 0;
+  std::uint64_t signature = kFnvOffset;
+  std::uint64_t totalNodes = 0;
+  std::uint64_t totalProbes = 0;
+  std::uint64_t totalHits = 0;
+  std::chrono::microseconds totalTime{0};
+  std::chrono::microseconds totalSearchTime{0};
+
+  for (const auto &file : files) {
+    PositionFile position;
+    if (!PositionFile::load(file, position) || !position.setUp(bot)) {
+      std::printf("%-36s  cannot load position\n", file.c_str());
+      ++failures;
+      continue;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto move = bot.chooseMove();
+    const auto wallTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    const Bot::SearchStats &stats = bot.lastSearchStats();
+    const Bot::Move played = move.value_or(Bot::Move{-1, -1});
+
+    mix(signature, static_cast<std::uint64_t>(played.first + 1));
+    mix(signature, static_cast<std::uint64_t>(played.second + 1));
+    mix(signature, stats.nodes);
+    totalNodes += stats.nodes;
+    totalProbes += stats.ttProbes;
+    totalHits += stats.ttHits;
+    totalTime += wallTime;
+    totalSearchTime += stats.elapsed;
+
+    std::printf("%-36s  move %2d,%-2d  depth %2d  nodes %10llu  "
+                "time %9.1f ms  nps %9llu  tt hits %5.1f%%\n",
+                position.name.c_str(), played.first, played.second,
+                stats.depth, static_cast<unsigned long long>(stats.nodes),
+                milliseconds(wallTime),
+                static_cast<unsigned long long>(
+                    nodesPerSecond(stats.nodes, stats.elapsed)),
+                hitRate(stats.ttHits, stats.ttProbes));
+    if (!stats.iterations.empty()) {
+      std::printf("  time to depth (ms):");
+      for (const auto &iteration : stats.iterations) {
+        std::printf(" %d:%.1f", iteration.depth, milliseconds(iteration.time));
+      }
+      std::printf("  ebf %.2f\n", stats.branchingFactor());
+    }
+  }
+
+  std::printf("\nTotal time (ms) : %.1f\n", milliseconds(totalTime));
+  std::printf("Nodes searched  : %llu\n",
+              static_cast<unsigned long long>(totalNodes));
+  std::printf("Nodes/second    : %llu\n",
+              static_cast<unsigned long long>(
+                  nodesPerSecond(totalNodes, totalSearchTime)));
+  std::printf("TT hit rate     : %.1f%%\n", hitRate(totalHits, totalProbes));
+  std::printf("Signature       : %016llx\n",
+              static_cast<unsigned long long>(signature));
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,212 @@
+#include "BookBuilder.hpp"
+#include "Bot.hpp"
+#include "GameState.hpp"
+#include "OpeningBook.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+using Move = GameState::Move;
+using EntryKey = std::pair<std::uint64_t, std::uint16_t>;
+
+// Self-play games open with this many random plies near the centre so
+// that the searched continuations differ from game to game.
+constexpr int kRandomPlies = 3;
+constexpr int kMaxWeight = 0xFFFF;
+
+GameState::Player playerForPly(std::size_t ply) {
+  return ply % 2 == 0 ? GameState::Player::One : GameState::Player::Two;
+}
+
+std::vector<Move> parseGame(const std::string &line) {
+  std::string normalized = line;
+  std::replace(normalized.begin(), normalized.end(), ',', ' ');
+  std::istringstream iss(normalized);
+  std::vector<Move> moves;
+  int x = 0;
+  int y = 0;
+  while (iss >> x >> y) {
+    moves.emplace_back(x, y);
+  }
+  return moves;
+}
+
+class Collector {
+public:
+  Collector(int boardSize, int plies) : boardSize_(boardSize), plies_(plies) {}
+
+  // Adds the opening of `moves`; `firstRecorded` skips plies that were not
+  // chosen on purpose (random self-play openings). Returns false if a move
+  // is illegal.
+  bool addGame(const std::vector<Move> &moves, std::size_t firstRecorded = 0) {
+    GameState state(boardSize_);
+    std::vector<std::pair<EntryKey, GameState::Player>> opening;
+    GameState::Player winner = GameState::Player::None;
+    for (std::size_t ply = 0; ply < moves.size(); ++ply) {
+      const auto [x, y] = moves[ply];
+      const GameState::Player mover = playerForPly(ply);
+      if (!state.isValid(x, y) || !state.isEmpty(x, y))
+        return false;
+      if (ply >= firstRecorded && ply < static_cast<std::size_t>(plies_)) {
+        int symmetry = 0;
+        const std::uint64_t key = state.canonicalHash(&symmetry);
+        const Move canonical = state.transform(symmetry, moves[ply]);
+        opening.push_back(
+            {{key, static_cast<std::uint16_t>((canonical.first << 8) |
+                                              canonical.second)},
+             mover});
+      }
+      state.play(x, y, mover);
+      if (state.checkWin(x, y)) {
+        winner = mover;
+        break;
+      }
+    }
+    for (const auto &[key, mover] : opening) {
+      int &weight = weights_[key];
+      weight = std::min(weight + (mover == winner ? 2 : 1), kMaxWeight);
+    }
+    ++games_;
+    return true;
+  }
+
+  std::vector<OpeningBook::Entry> entries() const {
+    std::vector<OpeningBook::Entry> entries;
+    entries.reserve(weights_.size());
+    for (const auto &[key, weight] : weights_) {
+      entries.push_back({key.first, {key.second >> 8, key.second & 0xFF},
+                         static_cast<std::uint16_t>(weight)});
+    }
+    return entries;
+  }
+
+  int games() const { return games_; }
+
+private:
+  int boardSize_;
+  int plies_;
+  int games_ = 0;
+  std::map<EntryKey, int> weights_;
+};
+
+int addRecords(Collector &collector, const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::fprintf(stderr, "book: cannot read %s\n", path.c_str());
+    return -1;
+  }
+  int skipped = 0;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    const auto moves = parseGame(line);
+    if (moves.empty() || !collector.addGame(moves)) {
+      ++skipped;
+    }
+  }
+  return skipped;
+}
+
+void addSelfPlay(Collector &collector, const BookBuilder::Options &options) {
+  std::mt19937 rng(std::random_device{}());
+  Bot bot;
+  bot.setRule(options.rule);
+  bot.setSearchLimits(options.depth, 0);
+
+  for (int game = 0; game < options.selfPlayGames; ++game) {
+    GameState state(options.boardSize);
+    if (!bot.start(options.boardSize))
+      return;
+    std::vector<Move> moves;
+    for (int ply = 0; ply < options.plies; ++ply) {
+      std::optional<Move> move;
+      if (ply < kRandomPlies) {
+        const auto &candidates = state.getLegalMoves();
+        move = candidates[std::uniform_int_distribution<std::size_t>(
+            0, candidates.size() - 1)(rng)];
+      } else {
+        move = bot.chooseMove();
+      }
+      if (!move)
+        break;
+      const GameState::Player mover = playerForPly(moves.size());
+      if (!bot.applyBoardMove(*move, mover == GameState::Player::One ? 1 : 2))
+        break;
+      state.play(move->first, move->second, mover);
+      moves.push_back(*move);
+      if (state.checkWin(move->first, move->second))
+        break;
+    }
+    collector.addGame(moves, kRandomPlies);
+  }
+}
+} // namespace
+
+BookBuilder::Options BookBuilder::parseArgs(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i + 1 < argc; ++i) {
+    const std::string arg(argv[i]);
+    const std::string value(argv[i + 1]);
+    try {
+      if (arg == "--build-book") {
+        options.output = value;
+      } else if (arg == "--games") {
+        options.records = value;
+      } else if (arg == "--self-play") {
+        options.selfPlayGames = std::stoi(value);
+      } else if (arg == "--plies") {
+        options.plies = std::stoi(value);
+      } else if (arg == "--depth") {
+        options.depth = std::stoi(value);
+      } else if (arg == "--size") {
+        options.boardSize = std::stoi(value);
+      } else if (arg == "--rule") {
+        options.rule = std::stoi(value);
+      } else {
+        continue;
+      }
+      ++i;
+    } catch (...) {
+    }
+  }
+  return options;
+}
+
+int BookBuilder::run(const Options &options) {
+  if (options.output.empty() ||
+      (options.records.empty() && options.selfPlayGames <= 0)) {
+    std::fprintf(stderr, "usage: --build-book OUT [--games FILE] "
+                         "[--self-play N] [--plies N] [--depth N] "
+                         "[--size N] [--rule N]\n");
+    return 1;
+  }
+
+  Collector collector(options.boardSize, options.plies);
+  if (!options.records.empty()) {
+    const int skipped = addRecords(collector, options.records);
+    if (skipped < 0)
+      return 1;
+    if (skipped > 0) {
+      std::printf("book: skipped %d unreadable games\n", skipped);
+    }
+  }
+  addSelfPlay(collector, options);
+
+  const auto entries = collector.entries();
+  if (!OpeningBook::write(options.output, options.boardSize, options.rule,
+                          entries)) {
+    std::fprintf(stderr, "book: cannot write %s\n", options.output.c_str());
+    return 1;
+  }
+  std::printf("book: %zu entries from %d games written to %s\n",
+              entries.size(), collector.games(), options.output.c_str());
+  return 0;
+}
@@ -1,20 +1,157 @@
 #include "Bot.hpp"
 #include "GameState.hpp"
+#include "Logger.hpp"
+#include "Patterns.hpp"
+#include "Renju.hpp"
+#include "Response.hpp"
 #include "TimeManager.hpp"
 
 #include <algorithm>
 #include <array>
+#include <cstdlib>
 #include <chrono>
 #include <cstdint>
+#include <cstdio>
 #include <string>
-#include <string_view>
+#include <thread>
 
 namespace {
 constexpr std::uint64_t kTurnKeys[2] = {0x243f6a8885a308d3ULL,
                                         0x13198a2e03707344ULL};
 constexpr std::uint64_t kIaKeys[2] = {0xa4093822299f31d0ULL,
                                       0x082efa98ec4e6c89ULL};
-constexpr std::size_t kMaxTranspositionEntries = 200000;
+
+// Threat-space search limits: depth in attacker moves, then nodes. The VCT
+// also gets at most a fifth of the optimum move time.
+constexpr int kVcfDepth = 12;
+constexpr std::size_t kVcfNodes = 200000;
+constexpr int kVctDepth = 6;
+constexpr std::size_t kVctNodes = 200000;
+constexpr int kVctBudgetDivisor = 5;
+// The proof-number search runs once the position has some substance, after
+// the threat solvers failed, on a quarter of the optimum move time.
+constexpr int kProofMinStones = 24;
+constexpr std::size_t kProofNodes = 2000000;
+constexpr int kProofBudgetDivisor = 4;
+
+constexpr int kInfinity = 2000000000;
+constexpr int kWinScore = 100000000;
+// Half-width of the first aspiration window around the previous score.
+constexpr int kAspirationWindow = 200;
+
+// Move ordering tiers. History scores stay below kHistoryLimit, so a move
+// in a higher tier always sorts first.
+constexpr int kHistoryLimit = 1 << 16;
+constexpr int kCounterMovePriority = 1 << 17;
+constexpr int kKillerPriority = 1 << 19;
+constexpr int kOpponentThreePriority = 1 << 20;
+constexpr int kThreePriority = 1 << 21;
+constexpr int kOpponentFourPriority = 1 << 22;
+constexpr int kFourPriority = 1 << 23;
+constexpr int kOpenFourPriority = 1 << 24;
+constexpr int kBlockFivePriority = 1 << 25;
+constexpr int kTtMovePriority = 1 << 26;
+// The move the previous turn's PV expected at this point of the line.
+constexpr int kPvMovePriority = 1 << 27;
+
+// Late move reductions: quiet moves from kLmrMinIndex on lose a ply once
+// depth reaches kLmrMinDepth, two plies deeper in the tree and list.
+constexpr int kLmrMinDepth = 3;
+constexpr std::size_t kLmrMinIndex = 3;
+constexpr int kLmrDeepDepth = 6;
+constexpr std::size_t kLmrDeepIndex = 10;
+
+// Quiescence search stops this many plies past the horizon.
+constexpr int kQuiescenceDepth = 8;
+
+// Futility pruning: how much a quiet move may still gain at depth 1 and 2.
+constexpr int kFutilityMaxDepth = 2;
+constexpr int kFutilityMargins[kFutilityMaxDepth + 1] = {0, 1000, 3000};
+
+// Time management between iterations: a new best move or a score that fell
+// since the last iteration of the same parity buys more time, and a search
+// whose next iteration would overrun the maximum stops right away.
+constexpr double kUnstableMoveScale = 1.5;
+constexpr int kScoreDropMargin = 1500;
+constexpr double kScoreDropScale = 2.0;
+constexpr long long kMinIterationGrowth = 2;
+constexpr long long kMaxIterationGrowth = 10;
+
+bool iterationEndsSearch(const std::vector<Bot::SearchIteration> &iterations,
+                         TimeManager &timer) {
+  const std::size_t count = iterations.size();
+  const Bot::SearchIteration &last = iterations.back();
+  if (last.score >= kWinScore)
+    return true;
+
+  double scale = 1.0;
+  if (count >= 2 && last.move != iterations[count - 2].move) {
+    scale *= kUnstableMoveScale;
+  }
+  if (count >= 3 &&
+      last.score < iterations[count - 3].score - kScoreDropMargin) {
+    scale *= kScoreDropScale;
+  }
+  timer.scaleOptimum(scale);
+
+  const auto elapsed = timer.elapsed();
+  if (elapsed >= timer.optimum())
+    return true;
+
+  const auto previousEnd =
+      count >= 2 ? iterations[count - 2].time : std::chrono::microseconds(0);
+  const auto lastTime = last.time - previousEnd;
+  long long growth = kMinIterationGrowth;
+  if (count >= 3) {
+    const auto previousTime = previousEnd - iterations[count - 3].time;
+    if (previousTime.count() > 0) {
+      growth = std::clamp(
+          static_cast<long long>(lastTime.count() / previousTime.count()),
+          kMinIterationGrowth, kMaxIterationGrowth);
+    }
+  }
+  return elapsed + std::chrono::duration_cast<std::chrono::milliseconds>(
+                       lastTime * growth) >
+         timer.maximum();
+}
+
+GameState::Player otherPlayer(GameState::Player player) {
+  return player == GameState::Player::One ? GameState::Player::Two
+                                          : GameState::Player::One;
+}
+
+// Ordering bonus for the shapes a move creates for the mover or takes away
+// from the opponent.
+int threatPriority(const GameState &state, const std::pair<int, int> &move,
+                   GameState::Player mover, GameState::Player opponent) {
+  std::uint8_t own = 0;
+  std::uint8_t theirs = 0;
+  for (int dir = 0; dir < GameState::kDirectionCount; ++dir) {
+    own |= Patterns::shape(
+        state.shapeWindow(dir, move.first, move.second, mover));
+    theirs |= Patterns::shape(
+        state.shapeWindow(dir, move.first, move.second, opponent));
+  }
+
+  int priority = 0;
+  if (theirs & Patterns::kFive)
+    priority += kBlockFivePriority;
+  if (own & Patterns::kOpenFour)
+    priority += kOpenFourPriority;
+  else if (own & Patterns::kFour)
+    priority += kFourPriority;
+  if (theirs & (Patterns::kOpenFour | Patterns::kFour))
+    priority += kOpponentFourPriority;
+  if (own & Patterns::kFreeThree)
+    priority += kThreePriority;
+  if (theirs & Patterns::kFreeThree)
+    priority += kOpponentThreePriority;
+  return priority;
+}
+
+int clampScore(long long score) {
+  return static_cast<int>(std::clamp<long long>(score, -kInfinity, kInfinity));
+}
 
 std::uint64_t playerKey(GameState::Player player,
                         const std::uint64_t keys[2]) {
@@ -27,179 +164,208 @@ std::uint64_t playerKey(GameState::Player player,
   return 0;
 }
 
+// With symmetry tracking the key is the canonical hash, and `symmetry`
+// maps the position (and its moves) onto the canonical orientation.
 std::uint64_t makeTranspositionKey(const GameState &state,
                                    GameState::Player current,
-                                   GameState::Player iaPlayer) {
-  return state.zobristHash() ^ playerKey(current, kTurnKeys) ^
-         playerKey(iaPlayer, kIaKeys);
+                                   GameState::Player iaPlayer, int &symmetry) {
+  symmetry = 0;
+  const std::uint64_t hash = state.tracksSymmetries()
+                                 ? state.canonicalHash(&symmetry)
+                                 : state.zobristHash();
+  return hash ^ playerKey(current, kTurnKeys) ^ playerKey(iaPlayer, kIaKeys);
 }
 } // namespace
 
 Bot::Bot() = default;
-Bot::~Bot() = default;
+Bot::~Bot() { stopPondering(); }
 
-void Bot::setRule(int rule) { rule_ = rule; }
+static bool isRenjuRule(int rule) { return rule == 2; }
 
-void Bot::setTimeoutTurnMs(int ms) {
-  constexpr int maxMs = 5000;
-  if (ms <= 0) {
-    timeoutTurn_ = std::chrono::milliseconds(maxMs);
-    return;
+void Bot::setRule(int rule) {
+  rule_ = rule;
+  if (gameState_) {
+    gameState_->trackForbidden(isRenjuRule(rule_));
   }
-  timeoutTurn_ = std::chrono::milliseconds(std::min(ms, maxMs));
 }
 
-static bool isRenjuRule(int rule) { return rule == 2; }
+void Bot::setTimeoutTurnMs(int ms) {
+  constexpr int defaultMs = 5000;
+  timeControl_.turn = std::chrono::milliseconds(ms > 0 ? ms : defaultMs);
+}
 
-static int countContiguousWithVirtualStone(const GameState &state, int x, int y,
-                                           int dx, int dy,
-                                           GameState::Player player) {
-  int cx = x + dx;
-  int cy = y + dy;
-  int count = 0;
-  while (state.isValid(cx, cy) && state.playerAt(cx, cy) == player) {
-    ++count;
-    cx += dx;
-    cy += dy;
-  }
-  return count;
-}
-
-static int maxLineLengthAfterMove(const GameState &state, int x, int y,
-                                  GameState::Player player) {
-  const std::array<std::pair<int, int>, 4> dirs = {
-      std::make_pair(1, 0), std::make_pair(0, 1), std::make_pair(1, 1),
-      std::make_pair(1, -1)};
-
-  int best = 1;
-  for (const auto &[dx, dy] : dirs) {
-    const int left =
-        countContiguousWithVirtualStone(state, x, y, -dx, -dy, player);
-    const int right =
-        countContiguousWithVirtualStone(state, x, y, dx, dy, player);
-    best = std::max(best, 1 + left + right);
+void Bot::setTimeoutMatchMs(long long ms) {
+  timeControl_.match = std::chrono::milliseconds(std::max(ms, 0LL));
+}
+
+void Bot::setTimeLeftMs(long long ms) {
+  timeControl_.left = std::chrono::milliseconds(std::max(ms, 0LL));
+}
+
+void Bot::setThreadCount(int count) {
+  threadCount_ = std::clamp(count, 1, kMaxThreads);
+}
+
+void Bot::setHashSizeMb(int mb) {
+  if (mb <= 0) {
+    return;
   }
-  return best;
+  hashBytes_ = static_cast<std::size_t>(mb) << 20;
+  resizeTranspositionTable();
 }
 
-static bool hasFourThreatInDirection(const GameState &state, int x, int y,
-                                     int dx, int dy, GameState::Player player) {
-  for (int startOffset = -4; startOffset <= 0; ++startOffset) {
-    int playerCount = 0;
-    int opponentCount = 0;
-    int emptyCount = 0;
+void Bot::setMaxMemory(long long bytes) {
+  maxMemory_ = bytes > 0 ? static_cast<std::size_t>(bytes) : 0;
+  resizeTranspositionTable();
+}
 
-    for (int i = 0; i < 5; ++i) {
-      const int px = x + (startOffset + i) * dx;
-      const int py = y + (startOffset + i) * dy;
-      if (!state.isValid(px, py)) {
-        opponentCount = 1;
-        break;
-      }
+void Bot::setSearchLimits(int depth, std::uint64_t nodes) {
+  maxDepth_ = std::clamp(depth, 1, kMaxDepth);
+  nodeLimit_ = nodes;
+  fixedLimits_ = true;
+}
 
-      if (px == x && py == y) {
-        ++playerCount;
-        continue;
-      }
+const Bot::SearchStats &Bot::lastSearchStats() const { return stats_; }
 
-      const auto cell = state.playerAt(px, py);
-      if (cell == GameState::Player::None) {
-        ++emptyCount;
-      } else if (cell == player) {
-        ++playerCount;
-      } else {
-        ++opponentCount;
-      }
-    }
+void Bot::setSearchReport(SearchReport report) { searchReport_ = report; }
 
-    if (opponentCount == 0 && playerCount == 4 && emptyCount == 1) {
-      return true;
-    }
+void Bot::setSymmetricHashing(bool enabled) {
+  symmetricHashing_ = enabled;
+  if (gameState_) {
+    gameState_->trackSymmetries(enabled);
   }
-  return false;
+  transpositionTable_.clear();
 }
 
-static bool hasFreeThreeInDirection(const GameState &state, int x, int y,
-                                    int dx, int dy, GameState::Player player) {
-  constexpr int radius = 5;
-  std::string line;
-  line.reserve(2 * radius + 1);
+void Bot::setBookPath(const std::string &path) {
+  bookPath_ = path;
+  if (path.empty()) {
+    book_.unload();
+  }
+}
 
-  for (int i = -radius; i <= radius; ++i) {
-    const int px = x + i * dx;
-    const int py = y + i * dy;
-    if (!state.isValid(px, py)) {
-      line.push_back('#');
-      continue;
-    }
-    if (px == x && py == y) {
-      line.push_back('X');
-      continue;
-    }
-    const auto cell = state.playerAt(px, py);
-    if (cell == GameState::Player::None) {
-      line.push_back('.');
-    } else if (cell == player) {
-      line.push_back('X');
-    } else {
-      line.push_back('O');
-    }
+void Bot::setPondering(bool enabled) {
+  if (!enabled) {
+    stopPondering();
   }
+  ponderEnabled_ = enabled;
+}
 
-  const int center = radius;
-  constexpr std::array<std::string_view, 5> patterns = {
-      ".XXX.", ".XX.X.", ".X.XX.", "..XXX.", ".XXX.."};
+void Bot::startPondering() {
+  if (!ponderEnabled_ || !gameState_ || ponderThread_.joinable())
+    return;
+  if (gameState_->getWinner() != GameState::Player::None ||
+      gameState_->getLegalMoves().empty())
+    return;
 
-  for (const auto pattern : patterns) {
-    std::size_t pos = line.find(pattern);
-    while (pos != std::string::npos) {
-      const int start = static_cast<int>(pos);
-      const int end = start + static_cast<int>(pattern.size()) - 1;
-      if (start <= center && center <= end) {
-        return true;
-      }
-      pos = line.find(pattern, pos + 1);
-    }
+  // We just moved, so the side to move is the opponent.
+  const GameState::Player us = otherPlayer(gameState_->currentPlayer());
+  if (ponderSearch_ &&
+      ponderSearch_->state.size() == gameState_->size()) {
+    ponderSearch_->reset(*gameState_);
+  } else {
+    ponderSearch_ = std::make_unique<SearchThread>(*gameState_, 0);
   }
-  return false;
+  ponderTimer_.start(std::chrono::hours(24));
+  ponderThread_ = std::thread([this, us] { ponder(*ponderSearch_, us); });
 }
 
-static bool isForbiddenRenjuMove(const GameState &state, int x, int y,
-                                 GameState::Player player) {
-  if (player != GameState::Player::One) {
-    return false;
-  }
+void Bot::stopPondering() {
+  if (!ponderThread_.joinable())
+    return;
+  ponderTimer_.stop();
+  ponderThread_.join();
+  Logger::instance().log(
+      "ponder: depth " + std::to_string(ponderSearch_->completedDepth) +
+      " nodes " + std::to_string(ponderSearch_->nodes));
+}
 
-  const int maxLen = maxLineLengthAfterMove(state, x, y, player);
-  if (maxLen > 5) {
-    return true;
-  }
-  if (maxLen == 5) {
-    return false;
-  }
+void Bot::SearchThread::reset(const GameState &root) {
+  state = root;
+  rootPly = static_cast<int>(root.history().size());
+  bestMove = {-1, -1};
+  bestScore = 0;
+  completedDepth = 0;
+  nodes = 0;
+  qnodes = 0;
+  ttProbes = 0;
+  ttHits = 0;
+  ttCutoffs = 0;
+  seldepth = 0;
+  iterations.clear();
+  pvLength.fill(0);
+  pv.clear();
+  predicted.clear();
+  onPredicted.fill(false);
+  predictedScore = 0;
+  std::fill(killers.begin(), killers.end(),
+            std::array<Move, 2>{Move{-1, -1}, Move{-1, -1}});
+  std::fill(history.begin(), history.end(), 0);
+  std::fill(counterMoves.begin(), counterMoves.end(), Move{-1, -1});
+}
 
-  const std::array<std::pair<int, int>, 4> dirs = {
-      std::make_pair(1, 0), std::make_pair(0, 1), std::make_pair(1, 1),
-      std::make_pair(1, -1)};
+void Bot::SearchThread::clearPv(int ply) {
+  pvLength[static_cast<std::size_t>(ply)] = ply;
+}
 
-  int fourThreatDirs = 0;
-  int freeThreeDirs = 0;
-  for (const auto &[dx, dy] : dirs) {
-    if (hasFourThreatInDirection(state, x, y, dx, dy, player)) {
-      ++fourThreatDirs;
-    }
-    if (hasFreeThreeInDirection(state, x, y, dx, dy, player)) {
-      ++freeThreeDirs;
+void Bot::SearchThread::updatePv(int ply, Move move) {
+  Move *row = pvTable.data() + static_cast<std::size_t>(ply) * kMaxPly;
+  const Move *child = row + kMaxPly;
+  const int end = pvLength[static_cast<std::size_t>(ply + 1)];
+  row[ply] = move;
+  std::copy(child + ply + 1, child + end, row + ply + 1);
+  pvLength[static_cast<std::size_t>(ply)] = std::max(end, ply + 1);
+}
+
+// Keeps `count` search threads for the current board, reset to its
+// position. They are only rebuilt when the board size changes.
+void Bot::prepareSearchThreads(int count) {
+  if (!searchThreads_.empty() &&
+      searchThreads_.front()->state.size() != gameState_->size()) {
+    searchThreads_.clear();
+  }
+  searchThreads_.resize(static_cast<std::size_t>(count));
+  for (int id = 0; id < count; ++id) {
+    auto &thread = searchThreads_[static_cast<std::size_t>(id)];
+    if (thread) {
+      thread->reset(*gameState_);
+    } else {
+      thread = std::make_unique<SearchThread>(*gameState_, id);
     }
   }
+}
 
-  if (fourThreatDirs >= 2) {
-    return true;
+// Plain iterative deepening from the opponent's point of view. Scores are
+// kept relative to `us` so the entries match the keys of our next search.
+void Bot::ponder(SearchThread &thread, GameState::Player us) {
+  for (int depth = 1; depth <= maxDepth_; ++depth) {
+    minimax(thread, depth, -kInfinity, kInfinity, false, us, ponderTimer_);
+    if (ponderTimer_.expired())
+      return;
+    thread.completedDepth = depth;
   }
-  if (freeThreeDirs >= 2) {
-    return true;
+}
+
+double Bot::SearchStats::branchingFactor() const {
+  if (iterations.size() < 2 || iterations[iterations.size() - 2].nodes == 0)
+    return 0.0;
+  return static_cast<double>(iterations.back().nodes) /
+         static_cast<double>(iterations[iterations.size() - 2].nodes);
+}
+
+// The table gets at most half of the manager's memory limit, leaving room
+// for the rest of the process.
+void Bot::resizeTranspositionTable() {
+  std::size_t bytes = hashBytes_;
+  if (maxMemory_ > 0) {
+    bytes = std::min(bytes, maxMemory_ / 2);
   }
-  return false;
+  transpositionTable_.resize(bytes);
+  std::size_t proofBytes = ProofSolver::kDefaultSizeMb << 20;
+  if (maxMemory_ > 0) {
+    proofBytes = std::min(proofBytes, maxMemory_ / 8);
+  }
+  proofSolver_.resize(proofBytes);
 }
 
 static bool isLegalMove(const GameState &state, int rule, int x, int y,
@@ -207,19 +373,29 @@ static bool isLegalMove(const GameState &state, int rule, int x, int y,
   if (!state.isValid(x, y) || !state.isEmpty(x, y)) {
     return false;
   }
-  if (isRenjuRule(rule) && isForbiddenRenjuMove(state, x, y, player)) {
+  if (isRenjuRule(rule) && player == GameState::Player::One &&
+      Renju::isForbidden(state, x, y)) {
     return false;
   }
   return true;
 }
 
 bool Bot::start(int size) {
-  if (size < 5 || size > 100)
+  if (size < GameState::kMinSize || size > GameState::kMaxSize)
     return false;
 
   gameState_ = std::make_unique<GameState>(size);
+  gameState_->trackSymmetries(symmetricHashing_);
+  gameState_->trackForbidden(isRenjuRule(rule_));
   transpositionTable_.clear();
-  transpositionTable_.reserve(kMaxTranspositionEntries);
+  clearExpectedLine();
+  if (!bookPath_.empty()) {
+    const bool loaded = book_.load(bookPath_);
+    Logger::instance().log(
+        loaded ? "book: " + std::to_string(book_.entryCount()) +
+                     " entries from " + bookPath_
+               : "book: cannot load " + bookPath_);
+  }
   return true;
 }
 
@@ -228,6 +404,7 @@ bool Bot::restart() {
     return false;
   gameState_->clear();
   transpositionTable_.clear();
+  clearExpectedLine();
   return true;
 }
 
@@ -275,210 +452,396 @@ bool Bot::applyBoardMove(Move move, int player) {
   return true;
 }
 
+void Bot::finishBoard() {
+  if (gameState_ && gameState_->stoneCount(GameState::Player::Two) >
+                        gameState_->stoneCount(GameState::Player::One)) {
+    gameState_->swapColours();
+  }
+}
+
 bool Bot::takeback(Move move) {
   if (!gameState_ || gameState_->history().empty())
     return false;
 
   if (gameState_->history().back() == move) {
     gameState_->undo();
+    clearExpectedLine();
     return true;
   }
   return false;
 }
 
-static int countPatterns(const GameState &state, GameState::Player player,
-                         int len) {
-  int count = 0;
-  int size = state.size();
-
-  for (int y = 0; y < size; ++y) {
-    for (int x = 0; x <= size - len - 2; ++x) {
-      if (!state.isEmpty(x, y) || !state.isEmpty(x + len + 1, y))
-        continue;
-      bool match = true;
-      for (int k = 1; k <= len; ++k) {
-        if (state.playerAt(x + k, y) != player) {
-          match = false;
-          break;
-        }
-      }
-      if (match)
-        count++;
-    }
-  }
-
-  for (int x = 0; x < size; ++x) {
-    for (int y = 0; y <= size - len - 2; ++y) {
-      if (!state.isEmpty(x, y) || !state.isEmpty(x, y + len + 1))
-        continue;
-      bool match = true;
-      for (int k = 1; k <= len; ++k) {
-        if (state.playerAt(x, y + k) != player) {
-          match = false;
-          break;
-        }
-      }
-      if (match)
-        count++;
-    }
-  }
-
-  for (int y = 0; y <= size - len - 2; ++y) {
-    for (int x = 0; x <= size - len - 2; ++x) {
-      if (!state.isEmpty(x, y) || !state.isEmpty(x + len + 1, y + len + 1))
-        continue;
-      bool match = true;
-      for (int k = 1; k <= len; ++k) {
-        if (state.playerAt(x + k, y + k) != player) {
-          match = false;
-          break;
-        }
-      }
-      if (match)
-        count++;
-    }
-  }
-
-  for (int y = len + 1; y < size; ++y) {
-    for (int x = 0; x <= size - len - 2; ++x) {
-      if (!state.isEmpty(x, y) || !state.isEmpty(x + len + 1, y - len - 1))
-        continue;
-      bool match = true;
-      for (int k = 1; k <= len; ++k) {
-        if (state.playerAt(x + k, y - k) != player) {
-          match = false;
-          break;
-        }
-      }
-      if (match)
-        count++;
-    }
-  }
-
-  return count;
-}
-
 int Bot::evaluateBoard(const GameState &state, GameState::Player player) const {
   GameState::Player opp = (player == GameState::Player::One)
                               ? GameState::Player::Two
                               : GameState::Player::One;
 
-  int myScore = 0;
-  int oppScore = 0;
-
-  int myOpen4 = countPatterns(state, player, 4);
-  int myOpen3 = countPatterns(state, player, 3);
-  int myOpen2 = countPatterns(state, player, 2);
-
-  int oppOpen4 = countPatterns(state, opp, 4);
-  int oppOpen3 = countPatterns(state, opp, 3);
-  int oppOpen2 = countPatterns(state, opp, 2);
-
-  myScore = myOpen4 * 10000 + myOpen3 * 1000 + myOpen2 * 100;
-  oppScore = oppOpen4 * 10000 + oppOpen3 * 1000 + oppOpen2 * 100;
-
-  return myScore - oppScore;
+  return state.patternScore(player) - state.patternScore(opp);
 }
 
-int Bot::minimax(int depth, int alpha, int beta, bool maximizingPlayer,
-                 GameState::Player iaPlayer, TimeManager &timer) {
-  if (timer.expired()) {
+int Bot::minimax(SearchThread &thread, int depth, int alpha, int beta,
+                 bool maximizingPlayer, GameState::Player iaPlayer,
+                 TimeManager &timer) {
+  if (timer.stopped()) {
     return 0;
   }
+  ++thread.nodes;
+  if ((thread.nodes & (TimeManager::kCheckInterval - 1)) == 0) {
+    (void)timer.expired();
+  }
+  if (nodeLimit_ > 0 && thread.id == 0 && thread.nodes >= nodeLimit_) {
+    timer.stop();
+  }
 
-  GameState::Player current = gameState_->currentPlayer();
-  std::uint64_t key = makeTranspositionKey(*gameState_, current, iaPlayer);
-  auto cached = transpositionTable_.find(key);
-  if (cached != transpositionTable_.end() && cached->second.depth >= depth) {
-    return cached->second.score;
+  GameState &state = thread.state;
+  const int ply = static_cast<int>(state.history().size()) - thread.rootPly;
+  thread.seldepth = std::max(thread.seldepth, ply);
+  thread.clearPv(ply);
+  const auto &predicted = thread.predicted;
+  const bool onPredicted =
+      ply > 0 && thread.onPredicted[static_cast<std::size_t>(ply - 1)] &&
+      static_cast<std::size_t>(ply - 1) < predicted.size() &&
+      state.history().back() == predicted[static_cast<std::size_t>(ply - 1)];
+  thread.onPredicted[static_cast<std::size_t>(ply)] = onPredicted;
+
+  using Bound = TranspositionTable::Bound;
+
+  GameState::Player current = state.currentPlayer();
+  int symmetry = 0;
+  std::uint64_t key = makeTranspositionKey(state, current, iaPlayer, symmetry);
+  TranspositionTable::Entry cached;
+  Move ttMove{-1, -1};
+  ++thread.ttProbes;
+  if (transpositionTable_.probe(key, cached)) {
+    ++thread.ttHits;
+    if (cached.move.first >= 0) {
+      ttMove = state.transform(GameState::inverseSymmetry(symmetry),
+                               cached.move);
+    }
+    if (cached.depth >= depth &&
+        (cached.bound == Bound::Exact ||
+         (cached.bound == Bound::Lower && cached.score >= beta) ||
+         (cached.bound == Bound::Upper && cached.score <= alpha))) {
+      ++thread.ttCutoffs;
+      return cached.score;
+    }
   }
-  auto storeResult = [&](int score) {
-    if (transpositionTable_.size() > kMaxTranspositionEntries) {
-      transpositionTable_.clear();
+
+  const int alphaOrig = alpha;
+  const int betaOrig = beta;
+  auto storeResult = [&](int score, Bound bound, Move best) {
+    if (best.first >= 0) {
+      best = state.transform(symmetry, best);
     }
-    transpositionTable_[key] = {depth, score};
+    transpositionTable_.store(key, depth, score, bound, best);
     return score;
   };
+  auto storeSearched = [&](int score, Move best) {
+    const Bound bound = score <= alphaOrig  ? Bound::Upper
+                        : score >= betaOrig ? Bound::Lower
+                                            : Bound::Exact;
+    return storeResult(score, bound, best);
+  };
 
   if (depth == 0) {
-    return storeResult(evaluateBoard(*gameState_, iaPlayer));
+    const int score = quiescence(thread, alpha, beta, maximizingPlayer,
+                                 iaPlayer, timer, 0);
+    if (timer.stopped())
+      return 0;
+    return storeSearched(score, {-1, -1});
   }
 
-  auto moves = gameState_->getLegalMoves();
+  const auto &moves = state.getLegalMoves();
   if (moves.empty()) {
-    return storeResult(evaluateBoard(*gameState_, iaPlayer));
+    return storeResult(evaluateBoard(state, iaPlayer), Bound::Exact,
+                       {-1, -1});
   }
 
   for (const auto &move : moves) {
-    if (gameState_->willWin(move.first, move.second, current)) {
-      return storeResult(maximizingPlayer ? 100000000 + depth
-                                          : -100000000 - depth);
+    if (state.willWin(move.first, move.second, current)) {
+      thread.clearPv(ply + 1);
+      thread.updatePv(ply, move);
+      return storeResult(maximizingPlayer ? kWinScore + depth
+                                          : -kWinScore - depth,
+                         Bound::Exact, move);
     }
   }
 
-  struct ScoredMove {
-    Move move;
-    int score;
-  };
+  // Cheap ordering first: TT move, threats, killers, countermove and
+  // history. Only moves none of those say anything about are scored by
+  // playing them and evaluating the result.
+  const GameState::Player opponent = otherPlayer(current);
+  const int side = current == GameState::Player::One ? 0 : 1;
+  const Move *killers =
+      ply < kMaxPly ? thread.killers[static_cast<std::size_t>(ply)].data()
+                    : nullptr;
+  Move counter{-1, -1};
+  if (!state.history().empty()) {
+    counter = thread.counterMoves[static_cast<std::size_t>(
+        thread.cell(state.history().back()))];
+  }
 
-  std::vector<ScoredMove> scoredMoves;
-  scoredMoves.reserve(moves.size());
+  ScoredMove *scoredMoves = thread.moveList(ply);
+  std::size_t moveCount = 0;
 
-  for (const auto &move : moves) {
-    if (!isLegalMove(*gameState_, rule_, move.first, move.second, current))
+  // Copy each move: playing it reorders the candidate list until undo().
+  for (std::size_t i = 0; i < moves.size(); ++i) {
+    const Move move = moves[i];
+    if (!isLegalMove(state, rule_, move.first, move.second, current))
       continue;
 
-    gameState_->play(move.first, move.second, current);
-    int score = evaluateBoard(*gameState_, iaPlayer);
-    gameState_->undo();
-    scoredMoves.push_back({move, score});
+    int priority = threatPriority(state, move, current, opponent);
+    if (move == ttMove) {
+      priority += kTtMovePriority;
+    }
+    if (onPredicted && static_cast<std::size_t>(ply) < predicted.size() &&
+        move == predicted[static_cast<std::size_t>(ply)]) {
+      priority += kPvMovePriority;
+    }
+    if (killers && move == killers[0]) {
+      priority += kKillerPriority;
+    } else if (killers && move == killers[1]) {
+      priority += kKillerPriority / 2;
+    }
+    if (move == counter) {
+      priority += kCounterMovePriority;
+    }
+    priority += thread.history[static_cast<std::size_t>(
+        side * thread.cells + thread.cell(move))];
+
+    int fallback = 0;
+    if (priority == 0) {
+      state.play(move.first, move.second, current);
+      fallback = evaluateBoard(state, iaPlayer);
+      state.undo();
+      if (!maximizingPlayer) {
+        fallback = -fallback;
+      }
+    }
+    scoredMoves[moveCount++] = {move, priority, fallback};
   }
 
-  if (maximizingPlayer) {
-    std::sort(scoredMoves.begin(), scoredMoves.end(),
-              [](const ScoredMove &a, const ScoredMove &b) {
-                return a.score > b.score;
-              });
+  std::sort(scoredMoves, scoredMoves + moveCount,
+            [](const ScoredMove &a, const ScoredMove &b) {
+              if (a.priority != b.priority)
+                return a.priority > b.priority;
+              return a.fallback > b.fallback;
+            });
+
+  // Principal variation search: the first move gets the full window, the
+  // others a null window around the bound they have to beat, and are only
+  // re-searched when they land inside the window.
+  //
+  // Quiet moves (no threat, not the TT move, a killer or the countermove)
+  // are pruned near the leaves when the static evaluation is too far from
+  // the window to catch up, and searched one or two plies shallower when
+  // they come late in the ordering; a reduced search that beats the bound
+  // is repeated at full depth.
+  const bool quietWindow =
+      std::abs(alpha) < kWinScore && std::abs(beta) < kWinScore;
+  const int staticEval = depth <= kFutilityMaxDepth && quietWindow
+                             ? evaluateBoard(state, iaPlayer)
+                             : 0;
+
+  int bestEval = maximizingPlayer ? -kInfinity : kInfinity;
+  Move bestMove{-1, -1};
+  for (std::size_t index = 0; index < moveCount; ++index) {
+    const Move move = scoredMoves[index].move;
+    const bool firstMove = index == 0;
+    const bool quiet = scoredMoves[index].priority < kCounterMovePriority;
+
+    if (!firstMove && quiet && quietWindow && depth <= kFutilityMaxDepth) {
+      const int margin = kFutilityMargins[depth];
+      if (maximizingPlayer && staticEval + margin <= alpha) {
+        bestEval = std::max(bestEval, staticEval + margin);
+        continue;
+      }
+      if (!maximizingPlayer && staticEval - margin >= beta) {
+        bestEval = std::min(bestEval, staticEval - margin);
+        continue;
+      }
+    }
 
-    int maxEval = -2000000000;
-    for (const auto &sm : scoredMoves) {
-      const auto &move = sm.move;
-      gameState_->play(move.first, move.second, current);
-      int eval = minimax(depth - 1, alpha, beta, false, iaPlayer, timer);
-      gameState_->undo();
+    int reduction = 0;
+    if (!firstMove && quiet && depth >= kLmrMinDepth &&
+        index >= kLmrMinIndex) {
+      reduction = (depth >= kLmrDeepDepth && index >= kLmrDeepIndex) ? 2 : 1;
+    }
 
-      if (timer.expired())
-        return 0;
+    state.play(move.first, move.second, current);
+    int eval = 0;
+    if (firstMove) {
+      eval = minimax(thread, depth - 1, alpha, beta, !maximizingPlayer,
+                     iaPlayer, timer);
+    } else if (maximizingPlayer) {
+      eval = minimax(thread, depth - 1 - reduction, alpha, alpha + 1, false,
+                     iaPlayer, timer);
+      if (reduction > 0 && eval > alpha) {
+        eval = minimax(thread, depth - 1, alpha, alpha + 1, false, iaPlayer,
+                       timer);
+      }
+      if (eval > alpha && eval < beta) {
+        eval = minimax(thread, depth - 1, alpha, beta, false, iaPlayer, timer);
+      }
+    } else {
+      eval = minimax(thread, depth - 1 - reduction, beta - 1, beta, true,
+                     iaPlayer, timer);
+      if (reduction > 0 && eval < beta) {
+        eval = minimax(thread, depth - 1, beta - 1, beta, true, iaPlayer,
+                       timer);
+      }
+      if (eval > alpha && eval < beta) {
+        eval = minimax(thread, depth - 1, alpha, beta, true, iaPlayer, timer);
+      }
+    }
+    state.undo();
 
-      maxEval = std::max(maxEval, eval);
+    if (timer.stopped())
+      return 0;
+
+    if (eval > alpha && eval < beta) {
+      thread.updatePv(ply, move);
+    }
+    if (maximizingPlayer) {
+      if (eval > bestEval) {
+        bestEval = eval;
+        bestMove = move;
+      }
       alpha = std::max(alpha, eval);
-      if (beta <= alpha)
-        break;
+    } else {
+      if (eval < bestEval) {
+        bestEval = eval;
+        bestMove = move;
+      }
+      beta = std::min(beta, eval);
     }
-    return storeResult(maxEval);
+    if (beta <= alpha) {
+      if (move != ttMove) {
+        rememberCutoff(thread, move, side, depth, ply);
+      }
+      break;
+    }
+  }
+  return storeSearched(bestEval, bestMove);
+}
+
+// Horizon search over forcing moves only: a five wins, the opponent's five
+// must be blocked, and otherwise the side to move may stand pat on the
+// static evaluation or try its fours. Standing pat is not allowed while
+// the opponent has a three that becomes an open four; the blocks of that
+// open four are searched next to our fours instead.
+int Bot::quiescence(SearchThread &thread, int alpha, int beta,
+                    bool maximizingPlayer, GameState::Player iaPlayer,
+                    TimeManager &timer, int qply) {
+  if (timer.stopped()) {
+    return 0;
+  }
+  ++thread.qnodes;
+  if ((thread.qnodes & (TimeManager::kCheckInterval - 1)) == 0) {
+    (void)timer.expired();
+  }
+
+  GameState &state = thread.state;
+  const int ply = static_cast<int>(state.history().size()) - thread.rootPly;
+  thread.seldepth = std::max(thread.seldepth, ply);
+
+  const GameState::Player current = state.currentPlayer();
+  const GameState::Player opponent = otherPlayer(current);
+  const int sign = maximizingPlayer ? 1 : -1;
+
+  // Our fours fill the node's move list from the front and the blocks from
+  // the back; the blocks are then appended behind the fours.
+  if (ply >= kMaxPly)
+    return evaluateBoard(state, iaPlayer);
+  ScoredMove *forcing = thread.moveList(ply);
+  const std::size_t capacity = static_cast<std::size_t>(thread.cells);
+  std::size_t fours = 0;
+  std::size_t blocks = 0;
+  int opponentFives = 0;
+  Move fiveBlock{-1, -1};
+  bool fiveBlockLegal = false;
+  const auto &moves = state.getLegalMoves();
+  for (std::size_t i = 0; i < moves.size(); ++i) {
+    const Move move = moves[i];
+    std::uint8_t own = 0;
+    std::uint8_t theirs = 0;
+    for (int dir = 0; dir < GameState::kDirectionCount; ++dir) {
+      own |= Patterns::shape(
+          state.shapeWindow(dir, move.first, move.second, current));
+      theirs |= Patterns::shape(
+          state.shapeWindow(dir, move.first, move.second, opponent));
+    }
+    if (!(own & (Patterns::kFive | Patterns::kFour)) &&
+        !(theirs & (Patterns::kFive | Patterns::kOpenFour)))
+      continue;
+    const bool legal =
+        isLegalMove(state, rule_, move.first, move.second, current);
+    if (legal && (own & Patterns::kFive))
+      return sign * (kWinScore - qply);
+    // The opponent's fives count even where we may not play: a five whose
+    // only block is forbidden is lost.
+    if (theirs & Patterns::kFive) {
+      ++opponentFives;
+      fiveBlock = move;
+      fiveBlockLegal = legal;
+    } else if (!legal) {
+      continue;
+    } else if (own & Patterns::kFour) {
+      forcing[fours++] = {move, 0, 0};
+    } else {
+      forcing[capacity - ++blocks] = {move, 0, 0};
+    }
+  }
+
+  const int staticEval = evaluateBoard(state, iaPlayer);
+  int best = staticEval;
+  std::size_t count = fours;
+  if (opponentFives > 1 || (opponentFives == 1 && !fiveBlockLegal))
+    return -sign * (kWinScore - qply - 1);
+  if (opponentFives == 1) {
+    forcing[0] = {fiveBlock, 0, 0};
+    count = 1;
+    best = -sign * kInfinity;
+  } else if (blocks > 0) {
+    std::reverse(forcing + capacity - blocks, forcing + capacity);
+    if (fours < capacity - blocks) {
+      std::copy(forcing + capacity - blocks, forcing + capacity,
+                forcing + fours);
+    }
+    count = fours + blocks;
+    best = -sign * kInfinity;
   } else {
-    std::sort(scoredMoves.begin(), scoredMoves.end(),
-              [](const ScoredMove &a, const ScoredMove &b) {
-                return a.score < b.score;
-              });
-
-    int minEval = 2000000000;
-    for (const auto &sm : scoredMoves) {
-      const auto &move = sm.move;
-      gameState_->play(move.first, move.second, current);
-      int eval = minimax(depth - 1, alpha, beta, true, iaPlayer, timer);
-      gameState_->undo();
-
-      if (timer.expired())
-        return 0;
-
-      minEval = std::min(minEval, eval);
+    if (maximizingPlayer ? staticEval >= beta : staticEval <= alpha)
+      return staticEval;
+    if (maximizingPlayer) {
+      alpha = std::max(alpha, staticEval);
+    } else {
+      beta = std::min(beta, staticEval);
+    }
+  }
+  if (count == 0 || qply >= kQuiescenceDepth)
+    return staticEval;
+
+  for (std::size_t index = 0; index < count; ++index) {
+    const Move move = forcing[index].move;
+    state.play(move.first, move.second, current);
+    const int eval = quiescence(thread, alpha, beta, !maximizingPlayer,
+                                iaPlayer, timer, qply + 1);
+    state.undo();
+    if (timer.stopped())
+      return 0;
+
+    if (maximizingPlayer) {
+      best = std::max(best, eval);
+      alpha = std::max(alpha, eval);
+    } else {
+      best = std::min(best, eval);
       beta = std::min(beta, eval);
-      if (beta <= alpha)
-        break;
     }
-    return storeResult(minEval);
+    if (beta <= alpha)
+      break;
   }
+  return best;
 }
 
 std::optional<Bot::Move> Bot::chooseMove() const {
@@ -486,15 +849,20 @@ std::optional<Bot::Move> Bot::chooseMove() const {
     return std::nullopt;
 
   TimeManager timer;
-  auto budget = timeoutTurn_;
-  if (budget > std::chrono::milliseconds(50)) {
-    budget -= std::chrono::milliseconds(50);
+  if (fixedLimits_) {
+    timer.start(std::chrono::hours(24));
+  } else {
+    timer.start(TimeManager::allocate(timeControl_, gameState_->stoneCount()));
+    Logger::instance().log(
+        "time: optimum " + std::to_string(timer.optimum().count()) +
+        "ms maximum " + std::to_string(timer.maximum().count()) + "ms");
   }
-  timer.start(budget);
 
   Bot *mutableBot = const_cast<Bot *>(this);
+  mutableBot->stats_ = SearchStats{};
+  mutableBot->transpositionTable_.newSearch();
 
-  auto moves = gameState_->getLegalMoves();
+  const auto &moves = gameState_->getLegalMoves();
   if (moves.empty())
     return std::nullopt;
 
@@ -503,8 +871,8 @@ std::optional<Bot::Move> Bot::chooseMove() const {
                                    ? GameState::Player::Two
                                    : GameState::Player::One;
 
-  std::vector<Move> legalMoves;
-  legalMoves.reserve(moves.size());
+  std::vector<Move> &legalMoves = mutableBot->rootMoves_;
+  legalMoves.clear();
   for (const auto &move : moves) {
     if (isLegalMove(*gameState_, rule_, move.first, move.second, us)) {
       legalMoves.push_back(move);
@@ -514,8 +882,6 @@ std::optional<Bot::Move> Bot::chooseMove() const {
   if (legalMoves.empty())
     return std::nullopt;
 
-  Move bestMove = legalMoves[0];
-
   for (const auto &move : legalMoves) {
     if (gameState_->willWin(move.first, move.second, us))
       return move;
@@ -525,38 +891,412 @@ std::optional<Bot::Move> Bot::chooseMove() const {
       return move;
   }
 
-  int maxDepth = 20;
-  for (int depth = 1; depth <= maxDepth; ++depth) {
+  if (const auto book = mutableBot->bookMove(us))
+    return book;
+
+  if (const auto threatWin = mutableBot->findThreatWin(us, timer))
+    return threatWin;
+
+  if (const auto proofWin = mutableBot->findProofWin(timer))
+    return proofWin;
+
+  const auto searchStart = TimeManager::Clock::now();
+  const int threadCount = threadCount_;
+  // When the game followed our last PV, its remaining moves are searched
+  // first, at the root and along the line.
+  const bool followed = followsExpectedLine();
+  const auto predicted = expectedLine_.begin() + (followed ? 2 : 0);
+  if (followed) {
+    const auto next = std::find(legalMoves.begin(), legalMoves.end(),
+                                *predicted);
+    if (next != legalMoves.end()) {
+      std::rotate(legalMoves.begin(), next, next + 1);
+    }
+  }
+  mutableBot->prepareSearchThreads(threadCount);
+  const auto &threads = searchThreads_;
+  for (const auto &thread : threads) {
+    thread->bestMove = legalMoves[0];
+    thread->startTime = searchStart;
+    if (followed) {
+      thread->predicted.assign(predicted, expectedLine_.end());
+      thread->predictedScore = expectedScore_;
+    }
+  }
+
+  std::vector<std::thread> helpers;
+  helpers.reserve(static_cast<std::size_t>(threadCount - 1));
+  for (int id = 1; id < threadCount; ++id) {
+    SearchThread &thread = *threads[static_cast<std::size_t>(id)];
+    helpers.emplace_back([mutableBot, &thread, &legalMoves, us, &timer] {
+      mutableBot->searchRoot(thread, legalMoves, us, timer);
+    });
+  }
+
+  mutableBot->searchRoot(*threads[0], legalMoves, us, timer);
+  timer.stop();
+  for (auto &helper : helpers) {
+    helper.join();
+  }
+
+  // Prefer the deepest completed iteration; the main thread wins ties.
+  const SearchThread *best = threads[0].get();
+  SearchStats &stats = mutableBot->stats_;
+  for (const auto &thread : threads) {
+    if (thread->completedDepth > best->completedDepth) {
+      best = thread.get();
+    }
+    stats.nodes += thread->nodes;
+    stats.qnodes += thread->qnodes;
+    stats.ttProbes += thread->ttProbes;
+    stats.ttHits += thread->ttHits;
+    stats.ttCutoffs += thread->ttCutoffs;
+    stats.seldepth = std::max(stats.seldepth, thread->seldepth);
+  }
+  stats.depth = best->completedDepth;
+  stats.score = best->bestScore;
+  stats.pv = best->pv;
+  stats.iterations = threads[0]->iterations;
+  mutableBot->expectedLine_ = best->pv;
+  mutableBot->expectedPly_ = gameState_->history().size();
+  mutableBot->expectedScore_ = best->bestScore;
+  stats.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      TimeManager::Clock::now() - searchStart);
+
+  if (Logger::instance().enabled()) {
+    const auto ms = stats.elapsed.count() / 1000;
+    char ebf[16];
+    std::snprintf(ebf, sizeof(ebf), "%.2f", stats.branchingFactor());
+    Logger::instance().log(
+        "search: depth " + std::to_string(stats.depth) + " seldepth " +
+        std::to_string(stats.seldepth) + " nodes " +
+        std::to_string(stats.nodes) + " qnodes " +
+        std::to_string(stats.qnodes) + " tt " +
+        std::to_string(stats.ttHits) + "/" + std::to_string(stats.ttProbes) +
+        " hits " + std::to_string(stats.ttCutoffs) + " cutoffs ebf " + ebf +
+        " threads " + std::to_string(threadCount) + " time " +
+        std::to_string(ms) + "ms move " + std::to_string(best->bestMove.first) +
+        "," + std::to_string(best->bestMove.second));
+  }
+  return best->bestMove;
+}
+
+// Whether the last two moves are the first two of the previous search's
+// PV, played from the position it searched, with more of the line left.
+bool Bot::followsExpectedLine() const {
+  const auto &history = gameState_->history();
+  return expectedLine_.size() > 2 &&
+         history.size() == expectedPly_ + 2 &&
+         history[expectedPly_] == expectedLine_[0] &&
+         history[expectedPly_ + 1] == expectedLine_[1];
+}
+
+// Forgets the last PV once the game it came from is left: a new game, a
+// new BOARD or a takeback.
+void Bot::clearExpectedLine() {
+  expectedLine_.clear();
+  expectedPly_ = 0;
+  expectedScore_ = 0;
+}
+
+// Records a move that caused a beta cutoff in the killer slots of its ply,
+// the butterfly history of its side and as the countermove to the move it
+// answered.
+void Bot::rememberCutoff(SearchThread &thread, Move move, int side, int depth,
+                         int ply) {
+  if (ply < kMaxPly) {
+    auto &killers = thread.killers[static_cast<std::size_t>(ply)];
+    if (killers[0] != move) {
+      killers[1] = killers[0];
+      killers[0] = move;
+    }
+  }
+
+  const auto &history = thread.state.history();
+  if (!history.empty()) {
+    thread.counterMoves[static_cast<std::size_t>(
+        thread.cell(history.back()))] = move;
+  }
+
+  int &score = thread.history[static_cast<std::size_t>(
+      side * thread.cells + thread.cell(move))];
+  score += depth * depth;
+  if (score > kHistoryLimit) {
+    for (int &entry : thread.history) {
+      entry /= 2;
+    }
+  }
+}
+
+// A weighted random pick among the legal book moves of the position.
+std::optional<Bot::Move> Bot::bookMove(GameState::Player us) {
+  if (!book_.loaded() || book_.rule() != rule_)
+    return std::nullopt;
+
+  auto moves = book_.probe(*gameState_);
+  const auto unusable = [this, us](const std::pair<Move, int> &entry) {
+    const auto [x, y] = entry.first;
+    return entry.second <= 0 || !gameState_->isValid(x, y) ||
+           !gameState_->isEmpty(x, y) ||
+           !isLegalMove(*gameState_, rule_, x, y, us);
+  };
+  moves.erase(std::remove_if(moves.begin(), moves.end(), unusable),
+              moves.end());
+  if (moves.empty())
+    return std::nullopt;
+
+  int total = 0;
+  for (const auto &entry : moves) {
+    total += entry.second;
+  }
+  int pick = std::uniform_int_distribution<int>(0, total - 1)(bookRng_);
+  for (const auto &entry : moves) {
+    pick -= entry.second;
+    if (pick < 0) {
+      Logger::instance().log("book move " + std::to_string(entry.first.first) +
+                             "," + std::to_string(entry.first.second));
+      return entry.first;
+    }
+  }
+  return std::nullopt;
+}
+
+// Runs the threat-space solver before the main search: first a VCF, then a
+// VCT on a fraction of the turn. Returns the first move of a proven win.
+std::optional<Bot::Move> Bot::findThreatWin(GameState::Player us,
+                                            const TimeManager &timer) {
+  const ThreatSolver::LegalityCheck legal =
+      [rule = rule_](const GameState &state, int x, int y,
+                     GameState::Player player) {
+        return isLegalMove(state, rule, x, y, player);
+      };
+
+  auto report = [](const char *kind, const ThreatSolver::Result &result) {
+    const Move &move = result.line.front();
+    Logger::instance().log(std::string(kind) + " win at " +
+                           std::to_string(move.first) + "," +
+                           std::to_string(move.second) + " (" +
+                           std::to_string(result.line.size()) + " plies, " +
+                           std::to_string(result.nodes) + " nodes)");
+  };
+
+  const auto vcf = threatSolver_.solve(*gameState_, us, ThreatSolver::Mode::Vcf,
+                                       kVcfDepth, kVcfNodes, timer, legal);
+  if (vcf.proven) {
+    report("VCF", vcf);
+    return vcf.line.front();
+  }
+
+  TimeManager vctTimer;
+  vctTimer.start(timer.optimum() / kVctBudgetDivisor);
+  const auto vct = threatSolver_.solve(*gameState_, us, ThreatSolver::Mode::Vct,
+                                       kVctDepth, kVctNodes, vctTimer, legal);
+  if (vct.proven) {
+    report("VCT", vct);
+    return vct.line.front();
+  }
+  return std::nullopt;
+}
+
+std::optional<Bot::Move> Bot::findProofWin(const TimeManager &timer) {
+  if (gameState_->stoneCount() < kProofMinStones)
+    return std::nullopt;
+
+  TimeManager proofTimer;
+  proofTimer.start(timer.optimum() / kProofBudgetDivisor);
+  const auto result = solve(kProofNodes, proofTimer);
+  // A lost root whose only block is forbidden has an empty line.
+  if (result.outcome == ProofSolver::Outcome::Unknown || result.line.empty())
+    return std::nullopt;
+
+  const Move &move = result.line.front();
+  const bool win = result.outcome == ProofSolver::Outcome::Win;
+  Logger::instance().log(std::string("proof: ") + (win ? "win" : "loss") +
+                         " starting " + std::to_string(move.first) + "," +
+                         std::to_string(move.second) + " (" +
+                         std::to_string(result.line.size()) + " plies, " +
+                         std::to_string(result.nodes) + " nodes)");
+  if (!win)
+    return std::nullopt;
+  return move;
+}
+
+ProofSolver::Result Bot::solve(std::size_t nodeLimit,
+                               const TimeManager &timer) {
+  if (!gameState_)
+    return {};
+  const ProofSolver::LegalityCheck legal =
+      [rule = rule_](const GameState &state, int x, int y,
+                     GameState::Player player) {
+        return isLegalMove(state, rule, x, y, player);
+      };
+  return proofSolver_.solve(*gameState_, nodeLimit, timer, legal);
+}
+
+// Iterative deepening over the root moves. Helper threads (Lazy SMP) run
+// the same loop on their own board copy: odd ids start one ply deeper and
+// each id starts from the root moves rotated by its id, so the threads fill
+// the shared transposition table with different parts of the tree.
+//
+// Each iteration searches the root with PVS inside an aspiration window
+// centred on the previous iteration's score, widening it on a fail low or
+// fail high, and the root moves are then reordered by their new scores.
+void Bot::searchRoot(SearchThread &thread, const std::vector<Move> &rootMoves,
+                     GameState::Player us, TimeManager &timer) {
+  GameState &state = thread.state;
+
+  std::vector<RootMove> &root = thread.rootList;
+  root.clear();
+  const std::size_t offset =
+      static_cast<std::size_t>(thread.id) % rootMoves.size();
+  for (std::size_t i = 0; i < rootMoves.size(); ++i) {
+    root.push_back({rootMoves[(i + offset) % rootMoves.size()], -kInfinity});
+  }
+  // A stable insertion sort: std::stable_sort would allocate a buffer.
+  auto sortRoot = [&root] {
+    for (std::size_t i = 1; i < root.size(); ++i) {
+      const RootMove entry = root[i];
+      std::size_t j = i;
+      for (; j > 0 && root[j - 1].score < entry.score; --j) {
+        root[j] = root[j - 1];
+      }
+      root[j] = entry;
+    }
+  };
+
+  // A predicted line from the previous turn also gives the first iteration
+  // an aspiration window, centred on that turn's score.
+  const bool predicted = !thread.predicted.empty();
+  thread.onPredicted[0] = predicted;
+  int previousScore = predicted ? thread.predictedScore : 0;
+  for (int depth = 1 + thread.id % 2; depth <= maxDepth_; ++depth) {
     if (timer.expired())
       break;
 
-    int bestVal = -2000000000;
-    Move currentBestMove = bestMove;
-    bool completedDepth = true;
+    int delta = kAspirationWindow;
+    int alpha = -kInfinity;
+    int beta = kInfinity;
+    if ((thread.completedDepth > 0 || predicted) &&
+        std::abs(previousScore) < kWinScore) {
+      alpha = clampScore(static_cast<long long>(previousScore) - delta);
+      beta = clampScore(static_cast<long long>(previousScore) + delta);
+    }
 
-    for (const auto &move : legalMoves) {
-      if (timer.expired()) {
-        completedDepth = false;
-        break;
-      }
+    const std::uint64_t nodesBefore = thread.nodes;
+    int bestVal = -kInfinity;
+    Move currentBestMove = thread.bestMove;
+    bool completedDepth = false;
+    while (!timer.expired()) {
+      bestVal = -kInfinity;
+      int windowAlpha = alpha;
+      thread.clearPv(0);
+      for (std::size_t i = 0; i < root.size(); ++i) {
+        const Move move = root[i].move;
+        state.play(move.first, move.second, us);
+        int val = 0;
+        if (i == 0) {
+          val = minimax(thread, depth - 1, windowAlpha, beta, false, us, timer);
+        } else {
+          val = minimax(thread, depth - 1, windowAlpha, windowAlpha + 1, false,
+                        us, timer);
+          if (val > windowAlpha && val < beta) {
+            val = minimax(thread, depth - 1, windowAlpha, beta, false, us,
+                          timer);
+          }
+        }
+        state.undo();
 
-      gameState_->play(move.first, move.second, us);
-      int val = mutableBot->minimax(depth - 1, -2000000000, 2000000000, false,
-                                    us, timer);
-      gameState_->undo();
+        if (timer.stopped())
+          break;
 
-      if (val > bestVal) {
-        bestVal = val;
-        currentBestMove = move;
+        root[i].score = val;
+        if (val > windowAlpha && val < beta) {
+          thread.updatePv(0, move);
+        }
+        if (val > bestVal) {
+          bestVal = val;
+          currentBestMove = move;
+        }
+        windowAlpha = std::max(windowAlpha, val);
+        if (windowAlpha >= beta)
+          break;
       }
+      if (timer.stopped())
+        break;
+
+      sortRoot();
+      if (bestVal <= alpha && alpha > -kInfinity) {
+        alpha = clampScore(static_cast<long long>(alpha) - delta);
+        delta = clampScore(delta * 4LL);
+        continue;
+      }
+      if (bestVal >= beta && beta < kInfinity) {
+        beta = clampScore(static_cast<long long>(beta) + delta);
+        delta = clampScore(delta * 4LL);
+        continue;
+      }
+      completedDepth = true;
+      break;
     }
 
-    if (completedDepth && !timer.expired()) {
-      bestMove = currentBestMove;
+    if (completedDepth) {
+      thread.bestMove = currentBestMove;
+      thread.bestScore = bestVal;
+      thread.completedDepth = depth;
+      thread.pv.assign(thread.pvTable.begin(),
+                       thread.pvTable.begin() + thread.pvLength[0]);
+      previousScore = bestVal;
+      if (thread.id == 0) {
+        thread.iterations.push_back(
+            {depth, bestVal, currentBestMove, thread.nodes - nodesBefore,
+             std::chrono::duration_cast<std::chrono::microseconds>(
+                 TimeManager::Clock::now() - thread.startTime)});
+        reportIteration(thread);
+        if (iterationEndsSearch(thread.iterations, timer))
+          break;
+      }
     }
   }
+}
+
+// One line per completed iteration of the main thread, to the log and,
+// when enabled, to the manager. Nothing is formatted when both are off.
+void Bot::reportIteration(const SearchThread &thread) const {
+  Logger &logger = Logger::instance();
+  if (searchReport_ == SearchReport::None && !logger.enabled())
+    return;
+
+  const SearchIteration &iteration = thread.iterations.back();
+  const long long micros = iteration.time.count();
+  const std::uint64_t nps =
+      micros > 0 ? thread.nodes * 1000000ULL /
+                       static_cast<std::uint64_t>(micros)
+                 : 0;
+  std::string line =
+      "depth " + std::to_string(iteration.depth) + " seldepth " +
+      std::to_string(thread.seldepth) + " score " +
+      std::to_string(iteration.score) + " nodes " +
+      std::to_string(thread.nodes) + " qnodes " +
+      std::to_string(thread.qnodes) + " nps " + std::to_string(nps) +
+      " tthits " + std::to_string(thread.ttHits) + "/" +
+      std::to_string(thread.ttProbes) + " ttcuts " +
+      std::to_string(thread.ttCutoffs) + " time " +
+      std::to_string(micros / 1000) + "ms move " +
+      std::to_string(iteration.move.first) + "," +
+      std::to_string(iteration.move.second) + " pv";
+  for (const Move &move : thread.pv) {
+    line += " " + std::to_string(move.first) + "," +
+            std::to_string(move.second);
+  }
 
-  return bestMove;
+  // Response logs what it sends, so the log gets the line either way.
+  if (searchReport_ == SearchReport::Message) {
+    Response::message(line);
+  } else if (searchReport_ == SearchReport::Debug) {
+    Response::debug(line);
+  } else {
+    logger.log("iteration: " + line);
+  }
 }
 
 int Bot::boardSize() const { return gameState_ ? gameState_->size() : 0; }
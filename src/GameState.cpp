@@ -1,30 +1,148 @@
 #include "GameState.hpp"
+#include "Patterns.hpp"
+
 #include <algorithm>
 #include <cmath>
 #include <random>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 namespace {
 constexpr std::uint64_t kZobristSeed = 0x9e3779b97f4a7c15ULL;
+
+int playerSlot(GameState::Player player) {
+  return player == GameState::Player::One ? 0 : 1;
+}
+
+// Length of the run of set bits starting just above `pos`.
+int runAbove(std::uint64_t mask, int pos) {
+  if (pos >= 63) {
+    return 0;
+  }
+  const std::uint64_t rest = ~(mask >> (pos + 1));
+  return __builtin_ctzll(rest);
+}
+
+// Length of the run of set bits starting just below `pos`.
+int runBelow(std::uint64_t mask, int pos) {
+  if (pos <= 0) {
+    return 0;
+  }
+  const std::uint64_t rest = ~(mask << (64 - pos));
+  return __builtin_clzll(rest);
+}
+
+// Whole-board win scan: whether any of `count` line masks holds five in a
+// row. The AVX2 kernel tests four lines per step; the scalar one is the
+// fallback on other CPUs.
+bool anyFiveScalar(const std::uint64_t *masks, std::size_t count) {
+  std::uint64_t found = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    const std::uint64_t pairs = masks[i] & (masks[i] >> 1);
+    found |= pairs & (pairs >> 2) & (masks[i] >> 4);
+  }
+  return found != 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) bool anyFiveAvx2(const std::uint64_t *masks,
+                                                  std::size_t count) {
+  __m256i found = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256i lines =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(masks + i));
+    const __m256i pairs =
+        _mm256_and_si256(lines, _mm256_srli_epi64(lines, 1));
+    const __m256i fours =
+        _mm256_and_si256(pairs, _mm256_srli_epi64(pairs, 2));
+    found = _mm256_or_si256(
+        found, _mm256_and_si256(fours, _mm256_srli_epi64(lines, 4)));
+  }
+  return !_mm256_testz_si256(found, found) ||
+         anyFiveScalar(masks + i, count - i);
+}
+#endif
+
+bool anyFive(const std::uint64_t *masks, std::size_t count) {
+  using Scan = bool (*)(const std::uint64_t *, std::size_t);
+  static const Scan scan = [] {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2"))
+      return &anyFiveAvx2;
+#endif
+    return &anyFiveScalar;
+  }();
+  return scan(masks, count);
+}
+
+// Maps a unit step onto its line family and whether it walks up the mask.
+int directionOf(int dx, int dy, bool &forward) {
+  if (dy == 0) {
+    forward = dx > 0;
+    return 0;
+  }
+  if (dx == 0) {
+    forward = dy > 0;
+    return 1;
+  }
+  forward = dx > 0;
+  return (dx == dy) ? 2 : 3;
+}
+constexpr int kCandidateRadius = 2;
+
+// Stored in the padding around the board; never returned by playerAt().
+constexpr GameState::Player kWall = static_cast<GameState::Player>(3);
 } // namespace
 
-GameState::GameState(int size) : size_(20), board_(20 * 20, Player::None) {
-  (void)size;
+GameState::GameState(int size)
+    : size_(std::clamp(size, kMinSize, kMaxSize)),
+      stride_(size_ + 2 * kPadding),
+      directionStride_{1, stride_, stride_ + 1, 1 - stride_},
+      lineCount_(2 * size_ - 1),
+      board_(static_cast<std::size_t>(stride_ * stride_), kWall),
+      lines_(static_cast<std::size_t>(2 * kDirectionCount * lineCount_), 0),
+      lineFirst_(static_cast<std::size_t>(kDirectionCount * lineCount_), 0),
+      lineLast_(static_cast<std::size_t>(kDirectionCount * lineCount_), -1),
+      lineScores_(lines_.size(), 0), candidateRefs_(board_.size(), 0),
+      candidatePos_(board_.size(), 0) {
+  for (int line = 0; line < lineCount_; ++line) {
+    const int diagonal = line - (size_ - 1);
+    const int antiDiagonal = line;
+    const int bounds[kDirectionCount][2] = {
+        {0, line < size_ ? size_ - 1 : -1},
+        {0, line < size_ ? size_ - 1 : -1},
+        {std::max(0, diagonal), std::min(size_ - 1, size_ - 1 + diagonal)},
+        {std::max(0, antiDiagonal - (size_ - 1)),
+         std::min(size_ - 1, antiDiagonal)}};
+    for (int dir = 0; dir < kDirectionCount; ++dir) {
+      lineFirst_[dir * lineCount_ + line] = bounds[dir][0];
+      lineLast_[dir * lineCount_ + line] = bounds[dir][1];
+    }
+  }
+  for (int y = 0; y < size_; ++y) {
+    std::fill_n(board_.begin() + cellIndex(0, y), size_, Player::None);
+  }
+  candidates_.reserve(static_cast<std::size_t>(size_ * size_));
+  history_.reserve(static_cast<std::size_t>(size_ * size_));
+  openingMoves_.emplace_back(size_ / 2, size_ / 2);
   initZobrist();
 }
 
 int GameState::size() const { return size_; }
 
-GameState::Player GameState::currentPlayer() const {
-  if (!history_.empty()) {
-    return (history_.size() % 2 == 0) ? Player::One : Player::Two;
-  }
-  long p1Count = std::count(board_.begin(), board_.end(), Player::One);
-  long p2Count = std::count(board_.begin(), board_.end(), Player::Two);
+int GameState::stoneCount() const { return stoneCount_[0] + stoneCount_[1]; }
 
-  if (p1Count == p2Count) {
-    return Player::One;
-  }
-  return Player::Two;
+int GameState::stoneCount(Player player) const {
+  return player == Player::None ? 0 : stoneCount_[playerSlot(player)];
+}
+
+// Counted from the stones rather than the history, so that positions set
+// up with set() keep alternating correctly once moves are played on them.
+GameState::Player GameState::currentPlayer() const {
+  return stoneCount_[0] > stoneCount_[1] ? Player::Two : Player::One;
 }
 
 const std::vector<GameState::Move> &GameState::history() const {
@@ -35,7 +153,7 @@ GameState::Player GameState::playerAt(int x, int y) const {
   if (!isValid(x, y)) {
     return Player::None;
   }
-  return board_[y * size_ + x];
+  return board_[cellIndex(x, y)];
 }
 
 bool GameState::isValid(int x, int y) const {
@@ -48,6 +166,120 @@ bool GameState::isEmpty(int x, int y) const {
 
 std::uint64_t GameState::zobristHash() const { return zobristHash_; }
 
+std::uint64_t GameState::moveHash(int x, int y, Player player) const {
+  return zobristKey(y * size_ + x, player);
+}
+
+GameState::Move GameState::transform(int symmetry, Move move) const {
+  if (symmetry & 1) {
+    std::swap(move.first, move.second);
+  }
+  if (symmetry & 2) {
+    move.first = size_ - 1 - move.first;
+  }
+  if (symmetry & 4) {
+    move.second = size_ - 1 - move.second;
+  }
+  return move;
+}
+
+// Undoing a transpose-then-mirror means mirroring first, so with a
+// transpose the two mirror bits trade places.
+int GameState::inverseSymmetry(int symmetry) {
+  if ((symmetry & 1) && ((symmetry >> 1) & 1) != ((symmetry >> 2) & 1)) {
+    return symmetry ^ 6;
+  }
+  return symmetry;
+}
+
+std::uint64_t GameState::canonicalHash(int *symmetry) const {
+  std::uint64_t scanned[kSymmetryCount] = {};
+  const std::uint64_t *hashes = symmetryHashes_;
+  if (!trackSymmetries_) {
+    for (int y = 0; y < size_; ++y) {
+      for (int x = 0; x < size_; ++x) {
+        const Player player = board_[cellIndex(x, y)];
+        if (player == Player::None)
+          continue;
+        for (int sym = 0; sym < kSymmetryCount; ++sym) {
+          const Move image = transform(sym, {x, y});
+          scanned[sym] ^=
+              zobristKey(image.second * size_ + image.first, player);
+        }
+      }
+    }
+    hashes = scanned;
+  }
+  const int best = static_cast<int>(
+      std::min_element(hashes, hashes + kSymmetryCount) - hashes);
+  if (symmetry) {
+    *symmetry = best;
+  }
+  return hashes[best];
+}
+
+void GameState::trackSymmetries(bool enabled) {
+  trackSymmetries_ = enabled;
+  if (!enabled)
+    return;
+
+  const int cells = size_ * size_;
+  symmetryCells_.resize(static_cast<std::size_t>(kSymmetryCount * cells));
+  for (int sym = 0; sym < kSymmetryCount; ++sym) {
+    for (int cell = 0; cell < cells; ++cell) {
+      const Move image = transform(sym, {cell % size_, cell / size_});
+      symmetryCells_[static_cast<std::size_t>(sym * cells + cell)] =
+          image.second * size_ + image.first;
+    }
+  }
+  for (int sym = 0; sym < kSymmetryCount; ++sym) {
+    symmetryHashes_[sym] = 0;
+    for (int cell = 0; cell < cells; ++cell) {
+      symmetryHashes_[sym] ^= zobristKey(
+          symmetryCells_[static_cast<std::size_t>(sym * cells + cell)],
+          board_[cellIndex(cell % size_, cell / size_)]);
+    }
+  }
+}
+
+bool GameState::tracksSymmetries() const { return trackSymmetries_; }
+
+void GameState::trackForbidden(bool enabled) {
+  trackForbidden_ = enabled;
+  forbiddenCache_.assign(enabled ? board_.size() : 0, 0);
+}
+
+bool GameState::tracksForbidden() const { return trackForbidden_; }
+
+std::uint8_t GameState::forbiddenCache(int x, int y) const {
+  if (!trackForbidden_ || !isValid(x, y))
+    return 0;
+  return forbiddenCache_[cellIndex(x, y)];
+}
+
+void GameState::setForbiddenCache(int x, int y, std::uint8_t value) const {
+  if (trackForbidden_ && isValid(x, y)) {
+    forbiddenCache_[cellIndex(x, y)] = value;
+  }
+}
+
+// The walk may run into the padding; resetting wall cells is harmless.
+void GameState::invalidateForbidden(int x, int y) {
+  const int centre = cellIndex(x, y);
+  for (const int stride : directionStride_) {
+    for (int step = -kForbiddenRadius; step <= kForbiddenRadius; ++step) {
+      forbiddenCache_[static_cast<std::size_t>(centre + step * stride)] = 0;
+    }
+  }
+}
+
+std::uint64_t GameState::zobristKey(int cell, Player player) const {
+  if (player == Player::None)
+    return 0;
+  return zobristTable_[static_cast<std::size_t>(cell) * 2 +
+                       static_cast<std::size_t>(playerSlot(player))];
+}
+
 void GameState::initZobrist() {
   zobristTable_.assign(static_cast<std::size_t>(size_) * size_ * 2, 0);
   std::mt19937_64 rng(kZobristSeed);
@@ -62,17 +294,247 @@ void GameState::updateHash(int x, int y, Player oldPlayer, Player newPlayer) {
   if (!isValid(x, y) || oldPlayer == newPlayer) {
     return;
   }
-  const std::size_t base =
-      static_cast<std::size_t>(y * size_ + x) * 2;
-  if (oldPlayer == Player::One) {
-    zobristHash_ ^= zobristTable_[base];
-  } else if (oldPlayer == Player::Two) {
-    zobristHash_ ^= zobristTable_[base + 1];
+  const int cell = y * size_ + x;
+  zobristHash_ ^= zobristKey(cell, oldPlayer) ^ zobristKey(cell, newPlayer);
+  if (!trackSymmetries_) {
+    return;
+  }
+  const int cells = size_ * size_;
+  for (int sym = 0; sym < kSymmetryCount; ++sym) {
+    const int image =
+        symmetryCells_[static_cast<std::size_t>(sym * cells + cell)];
+    symmetryHashes_[sym] ^=
+        zobristKey(image, oldPlayer) ^ zobristKey(image, newPlayer);
+  }
+}
+
+int GameState::lineIndex(int dir, int x, int y) const {
+  switch (dir) {
+  case 0:
+    return y;
+  case 1:
+    return x;
+  case 2:
+    return x - y + size_ - 1;
+  default:
+    return x + y;
   }
-  if (newPlayer == Player::One) {
-    zobristHash_ ^= zobristTable_[base];
-  } else if (newPlayer == Player::Two) {
-    zobristHash_ ^= zobristTable_[base + 1];
+}
+
+int GameState::cellIndex(int x, int y) const {
+  return (y + kPadding) * stride_ + x + kPadding;
+}
+
+int GameState::lineOffset(int dir, int x, int y) const {
+  return dir == 1 ? y : x;
+}
+
+std::uint64_t &GameState::lineSlot(Player player, int dir, int line) {
+  return lines_[static_cast<std::size_t>(
+      (playerSlot(player) * kDirectionCount + dir) * lineCount_ + line)];
+}
+
+std::uint64_t GameState::lineSlot(Player player, int dir, int line) const {
+  return lines_[static_cast<std::size_t>(
+      (playerSlot(player) * kDirectionCount + dir) * lineCount_ + line)];
+}
+
+std::uint64_t GameState::lineBits(int dir, int x, int y,
+                                  Player player) const {
+  if (player == Player::None || !isValid(x, y)) {
+    return 0;
+  }
+  return lineSlot(player, dir, lineIndex(dir, x, y));
+}
+
+std::uint32_t GameState::shapeWindow(int dir, int x, int y,
+                                     Player player) const {
+  const Player opponent =
+      player == Player::One ? Player::Two : Player::One;
+  const int line = lineIndex(dir, x, y);
+  const int bounds = dir * lineCount_ + line;
+  const std::uint64_t onBoard = ((2ULL << lineLast_[bounds]) - 1) &
+                                ~((1ULL << lineFirst_[bounds]) - 1);
+  return Patterns::encodeWindow(lineSlot(player, dir, line),
+                                lineSlot(opponent, dir, line) | ~onBoard,
+                                lineOffset(dir, x, y));
+}
+
+void GameState::lineWindow(int dir, int x, int y, Player player, int radius,
+                           std::uint32_t &own, std::uint32_t &blocked) const {
+  const Player opponent =
+      player == Player::One ? Player::Two : Player::One;
+  const int line = lineIndex(dir, x, y);
+  const int bounds = dir * lineCount_ + line;
+  const std::uint64_t onBoard = ((2ULL << lineLast_[bounds]) - 1) &
+                                ~((1ULL << lineFirst_[bounds]) - 1);
+  std::uint64_t ownBits = lineSlot(player, dir, line);
+  std::uint64_t blockedBits = lineSlot(opponent, dir, line) | ~onBoard;
+  const int shift = lineOffset(dir, x, y) - radius;
+  if (shift >= 0) {
+    // Bits shifted in at the top are past the end of the line.
+    ownBits >>= shift;
+    blockedBits = (blockedBits >> shift) | ~(~0ULL >> shift);
+  } else {
+    ownBits <<= -shift;
+    blockedBits = (blockedBits << -shift) | ((1ULL << -shift) - 1);
+  }
+  const std::uint64_t low = (1ULL << radius) - 1;
+  const auto dropCentre = [&](std::uint64_t bits) {
+    return static_cast<std::uint32_t>((bits & low) |
+                                      ((bits >> 1) & (low << radius)));
+  };
+  own = dropCentre(ownBits);
+  blocked = dropCentre(blockedBits);
+}
+
+int GameState::patternScore(Player player) const {
+  if (player == Player::None) {
+    return 0;
+  }
+  return patternScore_[playerSlot(player)];
+}
+
+void GameState::rescoreLine(int dir, int line) {
+  const int bounds = dir * lineCount_ + line;
+  const std::uint64_t one = lineSlot(Player::One, dir, line);
+  const std::uint64_t two = lineSlot(Player::Two, dir, line);
+  const int scores[2] = {
+      Patterns::scoreLine(one, two, lineFirst_[bounds], lineLast_[bounds]),
+      Patterns::scoreLine(two, one, lineFirst_[bounds], lineLast_[bounds])};
+  for (int slot = 0; slot < 2; ++slot) {
+    int &cached = lineScores_[static_cast<std::size_t>(
+        (slot * kDirectionCount + dir) * lineCount_ + line)];
+    patternScore_[slot] += scores[slot] - cached;
+    cached = scores[slot];
+  }
+}
+
+void GameState::setCell(int x, int y, Player player) {
+  const int index = cellIndex(x, y);
+  const Player previous = board_[index];
+  if (previous == player) {
+    return;
+  }
+  updateHash(x, y, previous, player);
+  board_[index] = player;
+
+  for (int dir = 0; dir < kDirectionCount; ++dir) {
+    const int line = lineIndex(dir, x, y);
+    const std::uint64_t bit = 1ULL << lineOffset(dir, x, y);
+    if (previous != Player::None) {
+      lineSlot(previous, dir, line) &= ~bit;
+    }
+    if (player != Player::None) {
+      lineSlot(player, dir, line) |= bit;
+    }
+    rescoreLine(dir, line);
+  }
+  if (trackForbidden_) {
+    invalidateForbidden(x, y);
+  }
+  if (previous != Player::None) {
+    --stoneCount_[playerSlot(previous)];
+  }
+  if (player != Player::None) {
+    ++stoneCount_[playerSlot(player)];
+  }
+
+  if (previous == Player::None) {
+    if (candidateRefs_[index] > 0) {
+      eraseCandidate(index);
+    }
+    addNeighbours(x, y);
+  } else if (player == Player::None) {
+    removeNeighbours(x, y);
+    if (candidateRefs_[index] > 0) {
+      insertCandidate(index);
+    }
+  }
+}
+
+// Swap-removes a candidate. Its old slot is kept in candidatePos_ so that
+// insertCandidate() can put it back exactly where it was.
+void GameState::eraseCandidate(int index) {
+  const int slot = candidatePos_[index];
+  const Move last = candidates_.back();
+  candidates_[slot] = last;
+  candidatePos_[cellIndex(last.first, last.second)] = slot;
+  candidates_.pop_back();
+  candidatePos_[index] = slot;
+}
+
+void GameState::insertCandidate(int index) {
+  const Move move{index % stride_ - kPadding, index / stride_ - kPadding};
+  const int end = static_cast<int>(candidates_.size());
+  const int slot = std::min(candidatePos_[index], end);
+  if (slot == end) {
+    candidates_.push_back(move);
+  } else {
+    const Move occupant = candidates_[slot];
+    candidates_.push_back(occupant);
+    candidatePos_[cellIndex(occupant.first, occupant.second)] = end;
+    candidates_[slot] = move;
+  }
+  candidatePos_[index] = slot;
+}
+
+void GameState::addNeighbours(int x, int y) {
+  switch (size_) {
+  case 15:
+    addNeighboursFor<15>(x, y);
+    break;
+  case 20:
+    addNeighboursFor<20>(x, y);
+    break;
+  default:
+    addNeighboursFor<0>(x, y);
+  }
+}
+
+void GameState::removeNeighbours(int x, int y) {
+  switch (size_) {
+  case 15:
+    removeNeighboursFor<15>(x, y);
+    break;
+  case 20:
+    removeNeighboursFor<20>(x, y);
+    break;
+  default:
+    removeNeighboursFor<0>(x, y);
+  }
+}
+
+// Walls are never empty, so neighbours in the padding are counted but never
+// become candidates.
+template <int N> void GameState::addNeighboursFor(int x, int y) {
+  const int stride = N ? N + 2 * kPadding : stride_;
+  const int centre = (y + kPadding) * stride + x + kPadding;
+  for (int dy = -kCandidateRadius; dy <= kCandidateRadius; ++dy) {
+    for (int dx = -kCandidateRadius; dx <= kCandidateRadius; ++dx) {
+      const int index = centre + dy * stride + dx;
+      if ((dx == 0 && dy == 0) || ++candidateRefs_[index] != 1 ||
+          board_[index] != Player::None)
+        continue;
+      candidatePos_[index] = static_cast<int>(candidates_.size());
+      candidates_.emplace_back(x + dx, y + dy);
+    }
+  }
+}
+
+// Mirror of addNeighboursFor(), walking the neighbourhood backwards so that
+// undoing the latest move pops candidates in the order they were pushed.
+template <int N> void GameState::removeNeighboursFor(int x, int y) {
+  const int stride = N ? N + 2 * kPadding : stride_;
+  const int centre = (y + kPadding) * stride + x + kPadding;
+  for (int dy = kCandidateRadius; dy >= -kCandidateRadius; --dy) {
+    for (int dx = kCandidateRadius; dx >= -kCandidateRadius; --dx) {
+      const int index = centre + dy * stride + dx;
+      if ((dx == 0 && dy == 0) || --candidateRefs_[index] != 0 ||
+          board_[index] != Player::None)
+        continue;
+      eraseCandidate(index);
+    }
   }
 }
 
@@ -81,8 +543,7 @@ bool GameState::play(int x, int y, Player player) {
     return false;
   }
 
-  updateHash(x, y, Player::None, player);
-  board_[y * size_ + x] = player;
+  setCell(x, y, player);
   history_.emplace_back(x, y);
   return true;
 }
@@ -92,23 +553,48 @@ void GameState::undo() {
     return;
   }
   Move last = history_.back();
-  const int index = last.second * size_ + last.first;
-  updateHash(last.first, last.second, board_[index], Player::None);
-  board_[index] = Player::None;
+  setCell(last.first, last.second, Player::None);
   history_.pop_back();
 }
 
 void GameState::clear() {
-  std::fill(board_.begin(), board_.end(), Player::None);
+  for (int y = 0; y < size_; ++y) {
+    std::fill_n(board_.begin() + cellIndex(0, y), size_, Player::None);
+  }
+  std::fill(lines_.begin(), lines_.end(), 0);
+  std::fill(lineScores_.begin(), lineScores_.end(), 0);
+  patternScore_[0] = 0;
+  patternScore_[1] = 0;
+  stoneCount_[0] = 0;
+  stoneCount_[1] = 0;
+  std::fill(candidateRefs_.begin(), candidateRefs_.end(), 0);
+  candidates_.clear();
   history_.clear();
   zobristHash_ = 0;
+  std::fill(std::begin(symmetryHashes_), std::end(symmetryHashes_), 0);
+  std::fill(forbiddenCache_.begin(), forbiddenCache_.end(), 0);
 }
 
 void GameState::set(int x, int y, Player player) {
   if (isValid(x, y)) {
-    const int index = y * size_ + x;
-    updateHash(x, y, board_[index], player);
-    board_[index] = player;
+    setCell(x, y, player);
+  }
+}
+
+void GameState::swapColours() {
+  std::vector<std::pair<Move, Player>> stones;
+  for (int y = 0; y < size_; ++y) {
+    for (int x = 0; x < size_; ++x) {
+      const Player player = board_[cellIndex(x, y)];
+      if (player != Player::None) {
+        stones.push_back({{x, y}, player});
+      }
+    }
+  }
+  clear();
+  for (const auto &[move, player] : stones) {
+    setCell(move.first, move.second,
+            player == Player::One ? Player::Two : Player::One);
   }
 }
 
@@ -123,10 +609,7 @@ bool GameState::set(int x, int y, int player) {
   if (player < 0 || player > 2) {
     return false;
   }
-  const int index = y * size_ + x;
-  auto next = static_cast<Player>(player);
-  updateHash(x, y, board_[index], next);
-  board_[index] = next;
+  setCell(x, y, static_cast<Player>(player));
   return true;
 }
 
@@ -135,16 +618,14 @@ bool GameState::in_bounds(int x, int y) const { return isValid(x, y); }
 
 int GameState::countDirection(int x, int y, int dx, int dy,
                               Player player) const {
-  int count = 0;
-  int nx = x + dx;
-  int ny = y + dy;
-
-  while (isValid(nx, ny) && playerAt(nx, ny) == player) {
-    count++;
-    nx += dx;
-    ny += dy;
+  if (player == Player::None || !isValid(x, y)) {
+    return 0;
   }
-  return count;
+  bool forward = true;
+  const int dir = directionOf(dx, dy, forward);
+  const std::uint64_t mask = lineSlot(player, dir, lineIndex(dir, x, y));
+  const int pos = lineOffset(dir, x, y);
+  return forward ? runAbove(mask, pos) : runBelow(mask, pos);
 }
 
 bool GameState::checkWin(int x, int y) const {
@@ -153,16 +634,10 @@ bool GameState::checkWin(int x, int y) const {
     return false;
   }
 
-  const int directions[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
-
-  for (const auto &dir : directions) {
-    int dx = dir[0];
-    int dy = dir[1];
-
-    int count = 1 + countDirection(x, y, dx, dy, player) +
-                countDirection(x, y, -dx, -dy, player);
-
-    if (count >= 5) {
+  for (int dir = 0; dir < kDirectionCount; ++dir) {
+    const std::uint64_t mask = lineSlot(player, dir, lineIndex(dir, x, y));
+    const int pos = lineOffset(dir, x, y);
+    if (1 + runAbove(mask, pos) + runBelow(mask, pos) >= 5) {
       return true;
     }
   }
@@ -175,14 +650,10 @@ bool GameState::checkWinFor(Player player) const {
     return false;
   }
 
-  for (int y = 0; y < size_; ++y) {
-    for (int x = 0; x < size_; ++x) {
-      if (playerAt(x, y) == player && checkWin(x, y)) {
-        return true;
-      }
-    }
-  }
-  return false;
+  // A player's lines for all four directions are contiguous in lines_.
+  const std::size_t count =
+      static_cast<std::size_t>(kDirectionCount * lineCount_);
+  return anyFive(lines_.data() + playerSlot(player) * count, count);
 }
 
 GameState::Player GameState::getWinner() const {
@@ -196,73 +667,21 @@ GameState::Player GameState::getWinner() const {
 }
 
 bool GameState::willWin(int x, int y, Player player) const {
-  if (!isValid(x, y) || !isEmpty(x, y))
+  if (!isValid(x, y) || !isEmpty(x, y) || player == Player::None)
     return false;
 
-  const int directions[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
-
-  for (const auto &dir : directions) {
-    int dx = dir[0];
-    int dy = dir[1];
-    int count = 1 + countDirection(x, y, dx, dy, player) +
-                countDirection(x, y, -dx, -dy, player);
-    if (count >= 5)
+  for (int dir = 0; dir < kDirectionCount; ++dir) {
+    const std::uint64_t mask = lineSlot(player, dir, lineIndex(dir, x, y));
+    const int pos = lineOffset(dir, x, y);
+    if (1 + runAbove(mask, pos) + runBelow(mask, pos) >= 5)
       return true;
   }
   return false;
 }
 
-std::vector<GameState::Move> GameState::getLegalMoves() const {
-  std::vector<Move> moves;
-
-  bool hasStones = false;
-  for (const auto &p : board_) {
-    if (p != Player::None) {
-      hasStones = true;
-      break;
-    }
-  }
-
-  if (!hasStones) {
-    if (size_ > 0) {
-      moves.emplace_back(size_ / 2, size_ / 2);
-    }
-    return moves;
-  }
-
-  for (int y = 0; y < size_; ++y) {
-    for (int x = 0; x < size_; ++x) {
-      if (!isEmpty(x, y))
-        continue;
-
-      bool nearStone = false;
-      for (int dy = -2; dy <= 2 && !nearStone; ++dy) {
-        for (int dx = -2; dx <= 2; ++dx) {
-          if (dx == 0 && dy == 0)
-            continue;
-          int nx = x + dx;
-          int ny = y + dy;
-          if (isValid(nx, ny) && !isEmpty(nx, ny)) {
-            nearStone = true;
-            break;
-          }
-        }
-      }
-      if (nearStone) {
-        moves.emplace_back(x, y);
-      }
-    }
+const std::vector<GameState::Move> &GameState::getLegalMoves() const {
+  if (stoneCount_[0] + stoneCount_[1] == 0) {
+    return openingMoves_;
   }
-
-  if (moves.empty()) {
-    for (int y = 0; y < size_; ++y) {
-      for (int x = 0; x < size_; ++x) {
-        if (isEmpty(x, y)) {
-          moves.emplace_back(x, y);
-        }
-      }
-    }
-  }
-
-  return moves;
+  return candidates_;
 }
@@ -12,6 +12,7 @@ void Logger::enableStderr(bool enabled)
         disable();
         return;
     }
+    std::lock_guard<std::mutex> lock(mutex_);
     file_.reset();
     out_ = &std::cerr;
 }
@@ -21,6 +22,7 @@ bool Logger::setLogFile(const std::string &path)
     std::ofstream stream(path, std::ios::app);
     if (!stream.is_open())
         return false;
+    std::lock_guard<std::mutex> lock(mutex_);
     file_.emplace(std::move(stream));
     out_ = &(*file_);
     return true;
@@ -28,17 +30,20 @@ bool Logger::setLogFile(const std::string &path)
 
 void Logger::disable()
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     out_ = nullptr;
     file_.reset();
 }
 
 bool Logger::enabled() const
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     return out_ != nullptr;
 }
 
 void Logger::log(const std::string &message)
 {
+    std::lock_guard<std::mutex> lock(mutex_);
     if (!out_)
         return;
     (*out_) << message << '\n';
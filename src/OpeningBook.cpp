@@ -0,0 +1,142 @@
+#include "OpeningBook.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr char kMagic[4] = {'G', 'M', 'K', 'B'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kHeaderSize = 16;
+constexpr std::size_t kRecordSize = 12;
+
+std::uint32_t readU32(const unsigned char *bytes) {
+  std::uint32_t value = 0;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+template <typename T> void writeValue(std::ofstream &out, T value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+} // namespace
+
+OpeningBook::~OpeningBook() { unload(); }
+
+bool OpeningBook::load(const std::string &path) {
+  unload();
+
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat info {};
+  if (::fstat(fd, &info) != 0 ||
+      static_cast<std::size_t>(info.st_size) < kHeaderSize) {
+    ::close(fd);
+    return false;
+  }
+  const std::size_t size = static_cast<std::size_t>(info.st_size);
+  void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+
+  const auto *bytes = static_cast<const unsigned char *>(mapping);
+  if (std::memcmp(bytes, kMagic, sizeof(kMagic)) != 0 ||
+      readU32(bytes + 4) != kVersion ||
+      (size - kHeaderSize) % kRecordSize != 0) {
+    ::munmap(mapping, size);
+    return false;
+  }
+
+  mapping_ = mapping;
+  mappingSize_ = size;
+  boardSize_ = static_cast<int>(readU32(bytes + 8));
+  rule_ = static_cast<int>(readU32(bytes + 12));
+  records_ = bytes + kHeaderSize;
+  count_ = (size - kHeaderSize) / kRecordSize;
+  return true;
+}
+
+void OpeningBook::unload() {
+  if (mapping_) {
+    ::munmap(mapping_, mappingSize_);
+  }
+  mapping_ = nullptr;
+  mappingSize_ = 0;
+  records_ = nullptr;
+  count_ = 0;
+  boardSize_ = 0;
+  rule_ = 0;
+}
+
+OpeningBook::Entry OpeningBook::record(std::size_t index) const {
+  const unsigned char *bytes = records_ + index * kRecordSize;
+  Entry entry{};
+  std::uint16_t move = 0;
+  std::memcpy(&entry.key, bytes, sizeof(entry.key));
+  std::memcpy(&move, bytes + 8, sizeof(move));
+  std::memcpy(&entry.weight, bytes + 10, sizeof(entry.weight));
+  entry.move = {move >> 8, move & 0xFF};
+  return entry;
+}
+
+std::vector<std::pair<OpeningBook::Move, int>>
+OpeningBook::probe(const GameState &state) const {
+  std::vector<std::pair<Move, int>> moves;
+  if (!loaded() || state.size() != boardSize_)
+    return moves;
+
+  int symmetry = 0;
+  const std::uint64_t key = state.canonicalHash(&symmetry);
+  const int back = GameState::inverseSymmetry(symmetry);
+
+  // Lower bound on the key over the sorted records.
+  std::size_t first = 0;
+  std::size_t count = count_;
+  while (count > 0) {
+    const std::size_t half = count / 2;
+    if (record(first + half).key < key) {
+      first += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  for (std::size_t i = first; i < count_; ++i) {
+    const Entry entry = record(i);
+    if (entry.key != key)
+      break;
+    moves.emplace_back(state.transform(back, entry.move), entry.weight);
+  }
+  return moves;
+}
+
+bool OpeningBook::write(const std::string &path, int boardSize, int rule,
+                        std::vector<Entry> entries) {
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) {
+              if (a.key != b.key)
+                return a.key < b.key;
+              return a.weight > b.weight;
+            });
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    return false;
+  out.write(kMagic, sizeof(kMagic));
+  writeValue(out, kVersion);
+  writeValue(out, static_cast<std::uint32_t>(boardSize));
+  writeValue(out, static_cast<std::uint32_t>(rule));
+  for (const auto &entry : entries) {
+    writeValue(out, entry.key);
+    writeValue(out, static_cast<std::uint16_t>((entry.move.first << 8) |
+                                               entry.move.second));
+    writeValue(out, entry.weight);
+  }
+  return static_cast<bool>(out);
+}
@@ -0,0 +1,172 @@
+#include "Patterns.hpp"
+
+#include <array>
+
+namespace {
+// Weight of a five-cell window holding 0..5 own stones and no opponent.
+constexpr int kWindowWeights[6] = {0, 1, 12, 150, 2500, 100000};
+constexpr std::uint64_t kWindowMask = 0x1F;
+
+constexpr int kWindowCells = 2 * Patterns::kWindowRadius + 1;
+constexpr int kCentre = Patterns::kWindowRadius;
+
+// Spreads bit i of an 8-bit mask to bit 2i.
+constexpr std::array<std::uint16_t, 256> buildSpreadTable() {
+  std::array<std::uint16_t, 256> table{};
+  for (int mask = 0; mask < 256; ++mask) {
+    std::uint16_t spread = 0;
+    for (int bit = 0; bit < 8; ++bit) {
+      if (mask & (1 << bit)) {
+        spread = static_cast<std::uint16_t>(spread | (1 << (2 * bit)));
+      }
+    }
+    table[mask] = spread;
+  }
+  return table;
+}
+
+constexpr auto kSpread = buildSpreadTable();
+
+// Shapes recognised through the centre, '.' empty and 'X' own. A shape only
+// counts when one of its stones sits on the centre. A free three must be
+// able to become an open four, so .XXX. alone is not one: O.XXX.O is dead.
+struct ShapeDef {
+  const char *cells;
+  std::uint8_t flag;
+};
+
+constexpr ShapeDef kShapeDefs[] = {
+    {"XXXXX", Patterns::kFive},       {"XXXX.", Patterns::kFour},
+    {"XXX.X", Patterns::kFour},       {"XX.XX", Patterns::kFour},
+    {"X.XXX", Patterns::kFour},       {".XXXX", Patterns::kFour},
+    {".XXXX.", Patterns::kOpenFour},  {".XX.X.", Patterns::kFreeThree},
+    {".X.XX.", Patterns::kFreeThree}, {"..XXX.", Patterns::kFreeThree},
+    {".XXX..", Patterns::kFreeThree}};
+
+// One placement of a shape inside the nine-cell window, as the masks of
+// cells that must hold an own stone and cells that must be empty.
+struct Placement {
+  std::uint16_t own;
+  std::uint16_t empty;
+  std::uint8_t flag;
+};
+
+constexpr int countPlacements() {
+  int count = 0;
+  for (const auto &def : kShapeDefs) {
+    for (int i = 0; def.cells[i] != '\0'; ++i) {
+      const int start = kCentre - i;
+      int length = 0;
+      while (def.cells[length] != '\0') {
+        ++length;
+      }
+      if (def.cells[i] == 'X' && start >= 0 && start + length <= kWindowCells) {
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+constexpr std::array<Placement, countPlacements()> buildPlacements() {
+  std::array<Placement, countPlacements()> placements{};
+  std::size_t next = 0;
+  for (const auto &def : kShapeDefs) {
+    int length = 0;
+    while (def.cells[length] != '\0') {
+      ++length;
+    }
+    for (int i = 0; i < length; ++i) {
+      const int start = kCentre - i;
+      if (def.cells[i] != 'X' || start < 0 || start + length > kWindowCells) {
+        continue;
+      }
+      Placement placement{0, 0, def.flag};
+      for (int k = 0; k < length; ++k) {
+        const auto bit = static_cast<std::uint16_t>(1 << (start + k));
+        if (def.cells[k] == 'X') {
+          placement.own = static_cast<std::uint16_t>(placement.own | bit);
+        } else {
+          placement.empty = static_cast<std::uint16_t>(placement.empty | bit);
+        }
+      }
+      placements[next++] = placement;
+    }
+  }
+  return placements;
+}
+
+constexpr auto kPlacements = buildPlacements();
+
+// Flags of the window whose eight outer cells hold `own` and `blocked`
+// (bit i for the i-th cell, centre excluded).
+constexpr std::uint8_t classify(std::uint32_t own, std::uint32_t blocked) {
+  const auto widen = [](std::uint32_t bits) {
+    return static_cast<std::uint16_t>((bits & 0xF) | ((bits & 0xF0) << 1));
+  };
+  const std::uint16_t ownCells =
+      static_cast<std::uint16_t>(widen(own) | (1 << kCentre));
+  const std::uint16_t emptyCells = static_cast<std::uint16_t>(
+      ~(ownCells | widen(blocked)) & ((1 << kWindowCells) - 1));
+
+  std::uint8_t flags = 0;
+  for (const auto &placement : kPlacements) {
+    if ((ownCells & placement.own) == placement.own &&
+        (emptyCells & placement.empty) == placement.empty) {
+      flags |= placement.flag;
+    }
+  }
+  return flags;
+}
+
+// Only the 3^8 windows without a cell both own and blocked can occur.
+constexpr std::array<std::uint8_t, 1 << 16> buildShapeTable() {
+  std::array<std::uint8_t, 1 << 16> table{};
+  for (std::uint32_t own = 0; own < 256; ++own) {
+    for (std::uint32_t blocked = 0; blocked < 256; ++blocked) {
+      if ((own & blocked) == 0) {
+        table[kSpread[own] | (kSpread[blocked] << 1)] =
+            classify(own, blocked);
+      }
+    }
+  }
+  return table;
+}
+
+constexpr auto kShapeTable = buildShapeTable();
+} // namespace
+
+int Patterns::scoreLine(std::uint64_t own, std::uint64_t opponent, int first,
+                        int last) {
+  int score = 0;
+  for (int start = first; start + 4 <= last; ++start) {
+    if ((opponent >> start) & kWindowMask) {
+      continue;
+    }
+    const std::uint64_t window = (own >> start) & kWindowMask;
+    score += kWindowWeights[__builtin_popcountll(window)];
+  }
+  return score;
+}
+
+std::uint32_t Patterns::encodeWindow(std::uint64_t own, std::uint64_t blocked,
+                                     int pos) {
+  const int shift = pos - kWindowRadius;
+  if (shift >= 0) {
+    // Bits shifted in at the top are past the end of the line.
+    own >>= shift;
+    blocked = (blocked >> shift) | ~(~0ULL >> shift);
+  } else {
+    own <<= -shift;
+    blocked = (blocked << -shift) | ((1ULL << -shift) - 1);
+  }
+  const auto dropCentre = [](std::uint64_t bits) {
+    return static_cast<std::uint32_t>((bits & 0xF) | ((bits >> 1) & 0xF0));
+  };
+  return kSpread[dropCentre(own)] |
+         static_cast<std::uint32_t>(kSpread[dropCentre(blocked)] << 1);
+}
+
+std::uint8_t Patterns::shape(std::uint32_t window) {
+  return kShapeTable[window & 0xFFFF];
+}
@@ -0,0 +1,114 @@
+#include "PositionFile.hpp"
+#include "Bot.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+std::string trim(std::string value) {
+  const auto notSpace = [](unsigned char c) { return !std::isspace(c); };
+  value.erase(value.begin(),
+              std::find_if(value.begin(), value.end(), notSpace));
+  value.erase(std::find_if(value.rbegin(), value.rend(), notSpace).base(),
+              value.end());
+  return value;
+}
+
+std::string withSpaces(std::string value) {
+  std::replace(value.begin(), value.end(), ',', ' ');
+  return value;
+}
+
+bool startsWith(const std::string &line, const char *prefix) {
+  return line.rfind(prefix, 0) == 0;
+}
+} // namespace
+
+bool PositionFile::load(const std::string &path, PositionFile &position) {
+  std::ifstream file(path);
+  if (!file)
+    return false;
+
+  position = PositionFile{};
+  position.name = std::filesystem::path(path).filename().string();
+
+  std::string line;
+  while (std::getline(file, line)) {
+    line = trim(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    if (startsWith(line, "SIZE ")) {
+      std::istringstream iss(line.substr(5));
+      if (!(iss >> position.size))
+        return false;
+      continue;
+    }
+    if (startsWith(line, "RULE ")) {
+      std::istringstream iss(line.substr(5));
+      if (!(iss >> position.rule))
+        return false;
+      continue;
+    }
+    if (startsWith(line, "EXPECT ")) {
+      std::istringstream iss(withSpaces(line.substr(7)));
+      int x = 0;
+      int y = 0;
+      while (iss >> x >> y) {
+        position.expect.emplace_back(x, y);
+      }
+      continue;
+    }
+
+    std::istringstream iss(withSpaces(line));
+    int x = 0;
+    int y = 0;
+    int player = 0;
+    if (!(iss >> x >> y >> player))
+      return false;
+    position.stones.emplace_back(x, y, player);
+  }
+  return true;
+}
+
+std::vector<std::string> PositionFile::list(const std::string &directory) {
+  std::vector<std::string> paths;
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(directory, error)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".pos") {
+      paths.push_back(entry.path().string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+std::vector<std::string>
+PositionFile::collect(const std::vector<std::string> &paths) {
+  std::vector<std::string> files;
+  for (const auto &path : paths) {
+    if (std::filesystem::is_directory(path)) {
+      const auto listed = list(path);
+      files.insert(files.end(), listed.begin(), listed.end());
+    } else {
+      files.push_back(path);
+    }
+  }
+  return files;
+}
+
+bool PositionFile::setUp(Bot &bot) const {
+  if (!bot.start(size))
+    return false;
+  bot.setRule(rule);
+  for (const auto &[x, y, player] : stones) {
+    if (!bot.applyBoardMove({x, y}, player))
+      return false;
+  }
+  bot.finishBoard();
+  return true;
+}
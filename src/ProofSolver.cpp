@@ -0,0 +1,410 @@
+#include "ProofSolver.hpp"
+#include "Patterns.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+constexpr std::uint32_t kInfinity = 100000000;
+constexpr std::size_t kBucketSize = 4;
+constexpr std::uint64_t kAttackerKeys[2] = {0x3f84d5b5b5470917ULL,
+                                            0x9216d5d98979fb1bULL};
+// Garbage collection runs once nine tenths of the table are in use and
+// frees it down to half.
+constexpr std::size_t kGcTriggerTenths = 9;
+constexpr int kWorkBuckets = 33;
+
+GameState::Player otherPlayer(GameState::Player player) {
+  return player == GameState::Player::One ? GameState::Player::Two
+                                          : GameState::Player::One;
+}
+
+std::uint8_t shapesAt(const GameState &state, const GameState::Move &move,
+                      GameState::Player player) {
+  std::uint8_t shapes = 0;
+  for (int dir = 0; dir < GameState::kDirectionCount; ++dir) {
+    shapes |= Patterns::shape(
+        state.shapeWindow(dir, move.first, move.second, player));
+  }
+  return shapes;
+}
+
+std::uint32_t saturatingAdd(std::uint32_t a, std::uint32_t b) {
+  return static_cast<std::uint32_t>(std::min<std::uint64_t>(
+      kInfinity, static_cast<std::uint64_t>(a) + b));
+}
+
+// The 1+epsilon trick: a child may run a quarter past its sibling before
+// the search switches, which saves most of the back-and-forth.
+std::uint32_t widen(std::uint32_t value) {
+  return value >= kInfinity ? kInfinity
+                            : saturatingAdd(value, value / 4 + 1);
+}
+
+int workBucket(std::uint32_t work) {
+  return work == 0 ? 0 : 32 - __builtin_clz(work);
+}
+
+bool solved(std::uint32_t pn, std::uint32_t dn) { return pn == 0 || dn == 0; }
+} // namespace
+
+ProofSolver::ProofSolver(std::size_t bytes) { resize(bytes); }
+
+void ProofSolver::resize(std::size_t bytes) {
+  std::size_t buckets = 1;
+  while (buckets * 2 * kBucketSize * sizeof(Entry) <= bytes) {
+    buckets *= 2;
+  }
+  table_.assign(buckets * kBucketSize, Entry{});
+  bucketMask_ = buckets - 1;
+  used_ = 0;
+}
+
+std::size_t ProofSolver::sizeBytes() const {
+  return table_.size() * sizeof(Entry);
+}
+
+ProofSolver::Result ProofSolver::solve(const GameState &state,
+                                       std::size_t nodeLimit,
+                                       const TimeManager &timer,
+                                       const LegalityCheck &legal) {
+  state_ = state;
+  nodes_ = 0;
+  nodeLimit_ = nodeLimit;
+  aborted_ = false;
+  timer_ = &timer;
+  legal_ = &legal;
+  std::fill(table_.begin(), table_.end(), Entry{});
+  used_ = 0;
+  // Every ply fills a cell, so the search is never deeper than the board.
+  rootPly_ = state_.history().size();
+  const std::size_t cells =
+      static_cast<std::size_t>(state_.size() * state_.size());
+  if (plies_.size() < cells + 1) {
+    plies_.resize(cells + 1);
+  }
+
+  Result result;
+  const GameState::Player us = state.currentPlayer();
+  if (prove(us)) {
+    result.outcome = Outcome::Win;
+  } else if (!aborted_ && prove(otherPlayer(us))) {
+    result.outcome = Outcome::Loss;
+  }
+  if (result.outcome != Outcome::Unknown) {
+    result.line = proofLine();
+  }
+  result.nodes = nodes_;
+  return result;
+}
+
+bool ProofSolver::prove(GameState::Player attacker) {
+  attacker_ = attacker;
+  search(kInfinity, kInfinity);
+  std::uint32_t pn = 0;
+  std::uint32_t dn = 0;
+  lookup(nodeKey(state_.zobristHash()), pn, dn);
+  return pn == 0;
+}
+
+bool ProofSolver::outOfBudget() {
+  if (aborted_) {
+    return true;
+  }
+  if (++nodes_ > nodeLimit_ || ((nodes_ & 255) == 0 && timer_->expired())) {
+    aborted_ = true;
+  }
+  return aborted_;
+}
+
+// Generates the moves of the current node into `ply.moves`. Returns true
+// for a terminal node, with its proof and disproof numbers set; the moves
+// then hold the winning move after a win, or the cells of the fives that
+// cannot all be blocked after a loss.
+bool ProofSolver::expand(Ply &ply, std::uint32_t &pn,
+                         std::uint32_t &dn) const {
+  std::vector<Move> &moves = ply.moves;
+  std::vector<Move> &blocks = ply.blocks;
+  const GameState::Player mover = state_.currentPlayer();
+  const GameState::Player other = otherPlayer(mover);
+  const bool orNode = mover == attacker_;
+  auto finish = [&](bool moverWins) {
+    const bool attackerWins = moverWins == orNode;
+    pn = attackerWins ? 0 : kInfinity;
+    dn = attackerWins ? kInfinity : 0;
+    return true;
+  };
+
+  moves.clear();
+  blocks.clear();
+  for (const auto &move : state_.getLegalMoves()) {
+    const std::uint8_t own = shapesAt(state_, move, mover);
+    const std::uint8_t theirs = shapesAt(state_, move, other);
+    if (theirs & Patterns::kFive) {
+      blocks.push_back(move);
+    }
+    if (orNode && !(own & (Patterns::kFive | Patterns::kFour |
+                           Patterns::kOpenFour |
+                           Patterns::kFreeThree)))
+      continue;
+    if (!(*legal_)(state_, move.first, move.second, mover))
+      continue;
+    if (own & Patterns::kFive) {
+      moves.assign(1, move);
+      return finish(true);
+    }
+    moves.push_back(move);
+  }
+
+  if (blocks.size() == 1) {
+    const bool playable =
+        std::find(moves.begin(), moves.end(), blocks.front()) != moves.end() ||
+        (*legal_)(state_, blocks.front().first, blocks.front().second, mover);
+    if (playable) {
+      moves.assign(1, blocks.front());
+      return false;
+    }
+  }
+  // Two fives, or one whose only block is forbidden: the mover loses.
+  if (!blocks.empty()) {
+    moves = blocks;
+    return finish(false);
+  }
+  if (moves.empty()) {
+    // No threat left to play, or a full board: the attacker did not win.
+    pn = kInfinity;
+    dn = 0;
+    return true;
+  }
+  return false;
+}
+
+void ProofSolver::search(std::uint32_t thpn, std::uint32_t thdn) {
+  if (outOfBudget()) {
+    return;
+  }
+
+  const std::uint64_t key = nodeKey(state_.zobristHash());
+  const std::size_t startNodes = nodes_;
+  Ply &ply = plies_[state_.history().size() - rootPly_];
+  const std::vector<Move> &moves = ply.moves;
+  std::uint32_t pn = 1;
+  std::uint32_t dn = 1;
+  if (expand(ply, pn, dn)) {
+    store(key, pn, dn, 1);
+    return;
+  }
+
+  const GameState::Player mover = state_.currentPlayer();
+  const bool orNode = mover == attacker_;
+  std::vector<std::uint64_t> &keys = ply.keys;
+  keys.clear();
+  for (const auto &move : moves) {
+    keys.push_back(childKey(move));
+  }
+
+  // OR nodes minimise the proof number over their children and add up the
+  // disproof numbers; AND nodes the other way round.
+  while (true) {
+    std::size_t best = 0;
+    std::uint32_t bestValue = kInfinity + 1;
+    std::uint32_t bestOther = 0;
+    std::uint32_t second = kInfinity;
+    std::uint32_t sum = 0;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      std::uint32_t childPn = 1;
+      std::uint32_t childDn = 1;
+      lookup(keys[i], childPn, childDn);
+      const std::uint32_t value = orNode ? childPn : childDn;
+      const std::uint32_t other = orNode ? childDn : childPn;
+      sum = saturatingAdd(sum, other);
+      if (value < bestValue) {
+        second = std::min(second, bestValue);
+        bestValue = value;
+        bestOther = other;
+        best = i;
+      } else if (value < second) {
+        second = value;
+      }
+    }
+    bestValue = std::min(bestValue, kInfinity);
+    pn = orNode ? bestValue : sum;
+    dn = orNode ? sum : bestValue;
+    if (pn >= thpn || dn >= thdn || aborted_)
+      break;
+
+    const std::uint32_t threshold = std::min(orNode ? thpn : thdn,
+                                             widen(second));
+    const std::uint32_t otherThreshold = static_cast<std::uint32_t>(
+        std::min<std::uint64_t>(kInfinity,
+                                static_cast<std::uint64_t>(orNode ? thdn
+                                                                  : thpn) -
+                                    sum + bestOther));
+    state_.play(moves[best].first, moves[best].second, mover);
+    if (orNode) {
+      search(threshold, otherThreshold);
+    } else {
+      search(otherThreshold, threshold);
+    }
+    state_.undo();
+    if (aborted_)
+      break;
+  }
+  store(key, pn, dn, nodes_ - startNodes + 1);
+}
+
+// Follows proven children from the root: any proven attacker move, and the
+// defence that needed the most work to refute.
+std::vector<ProofSolver::Move> ProofSolver::proofLine() {
+  std::vector<Move> line;
+  Ply ply;
+  const std::vector<Move> &moves = ply.moves;
+  const int maxPlies = state_.size() * state_.size();
+  int played = 0;
+  while (played < maxPlies) {
+    std::uint32_t pn = 0;
+    std::uint32_t dn = 0;
+    if (expand(ply, pn, dn)) {
+      if (pn != 0 || moves.empty())
+        break;
+      if (state_.currentPlayer() != attacker_ &&
+          !(*legal_)(state_, moves.front().first, moves.front().second,
+                     state_.currentPlayer()))
+        break; // The only block is forbidden: the defender has no reply.
+      line.push_back(moves.front());
+      if (state_.currentPlayer() == attacker_)
+        break;
+      // The defender can only block one of the attacker's fives.
+      state_.play(moves.front().first, moves.front().second,
+                  state_.currentPlayer());
+      ++played;
+      continue;
+    }
+
+    const bool orNode = state_.currentPlayer() == attacker_;
+    const Move *next = nullptr;
+    std::uint32_t nextWork = 0;
+    for (const auto &move : moves) {
+      const Entry *entry = find(childKey(move));
+      if (!entry || entry->pn != 0)
+        continue;
+      if (!next || (!orNode && entry->work > nextWork)) {
+        next = &move;
+        nextWork = entry->work;
+      }
+      if (orNode)
+        break;
+    }
+    if (!next)
+      break;
+    line.push_back(*next);
+    state_.play(next->first, next->second, state_.currentPlayer());
+    ++played;
+  }
+  for (; played > 0; --played) {
+    state_.undo();
+  }
+  return line;
+}
+
+std::uint64_t ProofSolver::nodeKey(std::uint64_t hash) const {
+  return hash ^ kAttackerKeys[attacker_ == GameState::Player::One ? 0 : 1];
+}
+
+std::uint64_t ProofSolver::childKey(const Move &move) const {
+  return nodeKey(state_.zobristHash() ^
+                 state_.moveHash(move.first, move.second,
+                                 state_.currentPlayer()));
+}
+
+const ProofSolver::Entry *ProofSolver::find(std::uint64_t key) const {
+  const std::size_t base = (key & bucketMask_) * kBucketSize;
+  for (std::size_t i = base; i < base + kBucketSize; ++i) {
+    if (table_[i].work != 0 && table_[i].key == key) {
+      return &table_[i];
+    }
+  }
+  return nullptr;
+}
+
+void ProofSolver::lookup(std::uint64_t key, std::uint32_t &pn,
+                         std::uint32_t &dn) const {
+  if (const Entry *entry = find(key)) {
+    pn = entry->pn;
+    dn = entry->dn;
+    return;
+  }
+  pn = 1;
+  dn = 1;
+}
+
+// Updates the entry for `key`, or takes an empty slot of its bucket, or
+// evicts the bucket's least valuable entry: unsolved before solved, then
+// the least work.
+void ProofSolver::store(std::uint64_t key, std::uint32_t pn, std::uint32_t dn,
+                        std::size_t work) {
+  const std::uint32_t addedWork = static_cast<std::uint32_t>(
+      std::min<std::size_t>(work, kInfinity));
+  const std::size_t base = (key & bucketMask_) * kBucketSize;
+  Entry *victim = nullptr;
+  for (std::size_t i = base; i < base + kBucketSize; ++i) {
+    Entry &entry = table_[i];
+    if (entry.work != 0 && entry.key == key) {
+      entry.pn = pn;
+      entry.dn = dn;
+      entry.work = saturatingAdd(entry.work, addedWork);
+      return;
+    }
+    if (entry.work == 0) {
+      if (!victim || victim->work != 0) {
+        victim = &entry;
+      }
+      continue;
+    }
+    if (!victim || (victim->work != 0 &&
+                    (solved(victim->pn, victim->dn) >
+                         solved(entry.pn, entry.dn) ||
+                     (solved(victim->pn, victim->dn) ==
+                          solved(entry.pn, entry.dn) &&
+                      entry.work < victim->work)))) {
+      victim = &entry;
+    }
+  }
+
+  if (victim->work == 0) {
+    ++used_;
+  }
+  *victim = {key, pn, dn, addedWork};
+  if (used_ * 10 >= table_.size() * kGcTriggerTenths) {
+    collectGarbage();
+  }
+}
+
+// Drops the entries with the least work below them until at most half of
+// the table is in use, taking unsolved entries before solved ones.
+void ProofSolver::collectGarbage() {
+  const std::size_t target = table_.size() / 2;
+  for (const bool dropSolved : {false, true}) {
+    std::array<std::size_t, kWorkBuckets> histogram{};
+    for (const auto &entry : table_) {
+      if (entry.work != 0 && solved(entry.pn, entry.dn) == dropSolved) {
+        ++histogram[static_cast<std::size_t>(workBucket(entry.work))];
+      }
+    }
+    int cutoff = 0;
+    std::size_t freed = 0;
+    while (cutoff < kWorkBuckets && used_ - freed > target) {
+      freed += histogram[static_cast<std::size_t>(cutoff)];
+      ++cutoff;
+    }
+    for (auto &entry : table_) {
+      if (entry.work != 0 && solved(entry.pn, entry.dn) == dropSolved &&
+          workBucket(entry.work) < cutoff) {
+        entry = Entry{};
+        --used_;
+      }
+    }
+    if (used_ <= target)
+      return;
+  }
+}
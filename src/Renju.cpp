@@ -0,0 +1,248 @@
+#include "Renju.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace {
+constexpr int kRadius = GameState::kForbiddenRadius;
+constexpr int kWindow = 2 * kRadius + 1;
+constexpr int kCentre = kRadius;
+constexpr int kNeighbours = 2 * kRadius;
+constexpr int kTableSize = 59049; // 3^kNeighbours
+
+constexpr std::uint8_t kFive = 1 << 0;
+constexpr std::uint8_t kOverline = 1 << 1;
+
+// What a black stone on the centre makes along one line. threeCells marks
+// the window cells (bit = cell index, centre = kCentre) that would turn
+// the line into a straight four.
+struct LineShape {
+  std::uint8_t flags = 0;
+  std::uint8_t fours = 0;
+  std::uint16_t threeCells = 0;
+};
+
+// Cached verdicts; 0 means unknown.
+enum Verdict : std::uint8_t {
+  kUnknown = 0,
+  kLegal = 1,
+  kForbidden = 2,
+  kCheckThrees = 3
+};
+
+enum Cell : std::uint8_t { kEmpty = 0, kBlack = 1, kBlocked = 2 };
+using Line = std::array<std::uint8_t, kWindow>;
+
+struct Ternary {
+  std::array<std::uint16_t, 1 << kNeighbours> value{};
+  constexpr Ternary() {
+    for (int bits = 0; bits < (1 << kNeighbours); ++bits) {
+      int power = 1;
+      for (int i = 0; i < kNeighbours; ++i) {
+        if (bits & (1 << i)) {
+          value[static_cast<std::size_t>(bits)] =
+              static_cast<std::uint16_t>(value[static_cast<std::size_t>(
+                                             bits)] +
+                                         power);
+        }
+        power *= 3;
+      }
+    }
+  }
+};
+constexpr Ternary kTernary;
+
+bool exactFive(const Line &line, int start) {
+  for (int i = start; i < start + 5; ++i) {
+    if (line[static_cast<std::size_t>(i)] != kBlack)
+      return false;
+  }
+  return line[static_cast<std::size_t>(start - 1)] != kBlack &&
+         line[static_cast<std::size_t>(start + 5)] != kBlack;
+}
+
+// Empty cells that give exactly five through the centre.
+std::uint16_t completions(Line &line) {
+  std::uint16_t cells = 0;
+  for (int cell = kCentre - 4; cell <= kCentre + 4; ++cell) {
+    auto &value = line[static_cast<std::size_t>(cell)];
+    if (value != kEmpty)
+      continue;
+    value = kBlack;
+    const int low = std::max(cell, kCentre) - 4;
+    const int high = std::min(cell, kCentre);
+    for (int start = low; start <= high; ++start) {
+      if (exactFive(line, start)) {
+        cells = static_cast<std::uint16_t>(cells | (1u << cell));
+        break;
+      }
+    }
+    value = kEmpty;
+  }
+  return cells;
+}
+
+// Two completions five cells apart belong to one straight four.
+int straightFours(std::uint16_t cells) {
+  return __builtin_popcount(cells & (cells >> 5));
+}
+
+LineShape classify(Line &line) {
+  LineShape shape;
+  int run = 1;
+  for (int i = kCentre - 1; i >= 0 && line[static_cast<std::size_t>(i)] ==
+                                          kBlack;
+       --i) {
+    ++run;
+  }
+  for (int i = kCentre + 1;
+       i < kWindow && line[static_cast<std::size_t>(i)] == kBlack; ++i) {
+    ++run;
+  }
+  if (run == 5) {
+    shape.flags |= kFive;
+    return shape;
+  }
+  if (run > 5) {
+    shape.flags |= kOverline;
+    return shape;
+  }
+
+  const std::uint16_t fours = completions(line);
+  shape.fours = static_cast<std::uint8_t>(__builtin_popcount(fours) -
+                                          straightFours(fours));
+  if (shape.fours > 0)
+    return shape;
+
+  for (int cell = kCentre - 4; cell <= kCentre + 4; ++cell) {
+    auto &value = line[static_cast<std::size_t>(cell)];
+    if (value != kEmpty)
+      continue;
+    value = kBlack;
+    if (straightFours(completions(line)) > 0) {
+      shape.threeCells =
+          static_cast<std::uint16_t>(shape.threeCells | (1u << cell));
+    }
+    value = kEmpty;
+  }
+  return shape;
+}
+
+const std::vector<LineShape> &lineTable() {
+  static const std::vector<LineShape> table = [] {
+    std::vector<LineShape> shapes(kTableSize);
+    for (int index = 0; index < kTableSize; ++index) {
+      Line line{};
+      line[kCentre] = kBlack;
+      int rest = index;
+      int stones = 0;
+      for (int i = 0; i < kNeighbours; ++i) {
+        const int cell = i < kRadius ? i : i + 1;
+        line[static_cast<std::size_t>(cell)] =
+            static_cast<std::uint8_t>(rest % 3);
+        stones += rest % 3 == kBlack && cell >= kCentre - 4 &&
+                  cell <= kCentre + 4;
+        rest /= 3;
+      }
+      // A three needs two more stones within four cells.
+      if (stones >= 2) {
+        shapes[static_cast<std::size_t>(index)] = classify(line);
+      }
+    }
+    return shapes;
+  }();
+  return table;
+}
+
+// Stones placed by the recursive three check.
+struct Overlay {
+  std::array<GameState::Move, Renju::kMaxDepth + 1> stones;
+  int count = 0;
+};
+
+LineShape lineShape(const GameState &state, const Overlay &overlay, int dir,
+                    int x, int y) {
+  std::uint32_t own = 0;
+  std::uint32_t blocked = 0;
+  state.lineWindow(dir, x, y, GameState::Player::One, kRadius, own, blocked);
+  const int dx = GameState::kDirections[dir][0];
+  const int dy = GameState::kDirections[dir][1];
+  for (int i = 0; i < overlay.count; ++i) {
+    const int sx = overlay.stones[static_cast<std::size_t>(i)].first - x;
+    const int sy = overlay.stones[static_cast<std::size_t>(i)].second - y;
+    const int step = dx != 0 ? sx * dx : sy * dy;
+    if (step == 0 || step < -kRadius || step > kRadius || sx != step * dx ||
+        sy != step * dy)
+      continue;
+    own |= 1u << (step < 0 ? step + kRadius : step + kRadius - 1);
+  }
+  return lineTable()[kTernary.value[own] + 2 * kTernary.value[blocked]];
+}
+
+Verdict lineVerdict(const GameState &state, const Overlay &overlay, int x,
+                    int y, std::array<LineShape, GameState::kDirectionCount>
+                               &shapes) {
+  bool overline = false;
+  int fours = 0;
+  int threes = 0;
+  for (int dir = 0; dir < GameState::kDirectionCount; ++dir) {
+    shapes[static_cast<std::size_t>(dir)] =
+        lineShape(state, overlay, dir, x, y);
+    const LineShape &shape = shapes[static_cast<std::size_t>(dir)];
+    if (shape.flags & kFive)
+      return kLegal;
+    overline = overline || (shape.flags & kOverline);
+    fours += shape.fours;
+    threes += shape.threeCells != 0;
+  }
+  if (overline || fours >= 2)
+    return kForbidden;
+  return threes >= 2 ? kCheckThrees : kLegal;
+}
+
+bool forbidden(const GameState &state, Overlay &overlay, int x, int y) {
+  std::array<LineShape, GameState::kDirectionCount> shapes;
+  const bool cached = overlay.count == 0 && state.tracksForbidden();
+  Verdict verdict = cached ? static_cast<Verdict>(state.forbiddenCache(x, y))
+                           : kUnknown;
+  if (verdict == kUnknown || verdict == kCheckThrees) {
+    verdict = lineVerdict(state, overlay, x, y, shapes);
+    if (cached) {
+      state.setForbiddenCache(x, y, verdict);
+    }
+  }
+  if (verdict != kCheckThrees)
+    return verdict == kForbidden;
+  if (overlay.count >= Renju::kMaxDepth)
+    return true;
+
+  // A three is real only if one of its straight-four cells is legal once
+  // this stone is down.
+  overlay.stones[static_cast<std::size_t>(overlay.count++)] = {x, y};
+  int realThrees = 0;
+  for (int dir = 0; dir < GameState::kDirectionCount && realThrees < 2;
+       ++dir) {
+    const std::uint16_t cells = shapes[static_cast<std::size_t>(dir)]
+                                    .threeCells;
+    for (int cell = 0; cell < kWindow; ++cell) {
+      if (!(cells & (1u << cell)))
+        continue;
+      const int step = cell - kCentre;
+      if (!forbidden(state, overlay, x + step * GameState::kDirections[dir][0],
+                     y + step * GameState::kDirections[dir][1])) {
+        ++realThrees;
+        break;
+      }
+    }
+  }
+  --overlay.count;
+  return realThrees >= 2;
+}
+} // namespace
+
+bool Renju::isForbidden(const GameState &state, int x, int y) {
+  Overlay overlay;
+  return forbidden(state, overlay, x, y);
+}
@@ -0,0 +1,249 @@
+#include "ThreatSolver.hpp"
+#include "Patterns.hpp"
+
+#include <algorithm>
+
+namespace {
+constexpr std::size_t kTableSize = 1 << 16;
+constexpr std::uint64_t kAttackerKeys[2] = {0x452821e638d01377ULL,
+                                            0xbe5466cf34e90c6cULL};
+constexpr std::uint64_t kVctKey = 0xc0ac29b7c97c50ddULL;
+constexpr int kThreatReach = 4;
+} // namespace
+
+ThreatSolver::ThreatSolver() : table_(kTableSize) {}
+
+ThreatSolver::Result ThreatSolver::solve(const GameState &state,
+                                         GameState::Player attacker, Mode mode,
+                                         int maxDepth, std::size_t nodeLimit,
+                                         const TimeManager &timer,
+                                         const LegalityCheck &legal) {
+  state_ = state;
+  attacker_ = attacker;
+  defender_ = (attacker == GameState::Player::One) ? GameState::Player::Two
+                                                   : GameState::Player::One;
+  mode_ = mode;
+  nodes_ = 0;
+  nodeLimit_ = nodeLimit;
+  aborted_ = false;
+  timer_ = &timer;
+  legal_ = &legal;
+  std::fill(table_.begin(), table_.end(), HashEntry{});
+  rootPly_ = static_cast<int>(state_.history().size());
+  // Each attacker move and its reply take two plies.
+  if (plies_.size() < static_cast<std::size_t>(2 * maxDepth + 1)) {
+    plies_.resize(static_cast<std::size_t>(2 * maxDepth + 1));
+  }
+
+  Result result;
+  for (int depth = 1; depth <= maxDepth && !aborted_; ++depth) {
+    if (attack(depth, result.line)) {
+      result.proven = true;
+      break;
+    }
+  }
+  result.nodes = nodes_;
+  return result;
+}
+
+bool ThreatSolver::outOfBudget() {
+  if (aborted_) {
+    return true;
+  }
+  if (++nodes_ > nodeLimit_ || ((nodes_ & 255) == 0 && timer_->expired())) {
+    aborted_ = true;
+  }
+  return aborted_;
+}
+
+ThreatSolver::Ply &ThreatSolver::ply() {
+  Ply &lists = plies_[state_.history().size() -
+                      static_cast<std::size_t>(rootPly_)];
+  lists.wins.clear();
+  lists.fours.clear();
+  lists.threes.clear();
+  return lists;
+}
+
+std::uint64_t ThreatSolver::hashKey() const {
+  return state_.zobristHash() ^
+         kAttackerKeys[attacker_ == GameState::Player::One ? 0 : 1] ^
+         (mode_ == Mode::Vct ? kVctKey : 0);
+}
+
+void ThreatSolver::collectWins(GameState::Player player,
+                               std::vector<Move> &wins) const {
+  for (const auto &move : state_.getLegalMoves()) {
+    if (state_.willWin(move.first, move.second, player) &&
+        (*legal_)(state_, move.first, move.second, player)) {
+      wins.push_back(move);
+    }
+  }
+}
+
+bool ThreatSolver::makesFour(Move move, GameState::Player player) const {
+  for (int dir = 0; dir < GameState::kDirectionCount; ++dir) {
+    const auto shape = Patterns::shape(
+        state_.shapeWindow(dir, move.first, move.second, player));
+    if (shape & Patterns::kFour) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreatSolver::collectThreats(std::vector<Move> &fours,
+                                  std::vector<Move> &threes) const {
+  for (const auto &move : state_.getLegalMoves()) {
+    std::uint8_t shapes = 0;
+    for (int dir = 0; dir < GameState::kDirectionCount; ++dir) {
+      shapes |= Patterns::shape(
+          state_.shapeWindow(dir, move.first, move.second, attacker_));
+    }
+    if (!(shapes & (Patterns::kFour | Patterns::kFreeThree))) {
+      continue;
+    }
+    if (!(*legal_)(state_, move.first, move.second, attacker_)) {
+      continue;
+    }
+    if (shapes & Patterns::kFour) {
+      fours.push_back(move);
+    } else if (mode_ == Mode::Vct) {
+      threes.push_back(move);
+    }
+  }
+}
+
+// Attacker to move: true when a forcing sequence of at most `depth` more
+// attacker moves wins. `line` receives the winning continuation.
+bool ThreatSolver::attack(int depth, std::vector<Move> &line) {
+  if (outOfBudget()) {
+    return false;
+  }
+
+  Ply &lists = ply();
+  std::vector<Move> &wins = lists.wins;
+  collectWins(attacker_, wins);
+  if (!wins.empty()) {
+    line.assign(1, wins.front());
+    return true;
+  }
+  if (depth <= 0) {
+    return false;
+  }
+
+  const std::uint64_t key = hashKey();
+  HashEntry &entry = table_[key & (kTableSize - 1)];
+  if (entry.key == key && entry.depth >= depth) {
+    return false;
+  }
+
+  std::vector<Move> &defenderWins = wins;
+  collectWins(defender_, defenderWins);
+
+  std::vector<Move> &fours = lists.fours;
+  std::vector<Move> &threes = lists.threes;
+  collectThreats(fours, threes);
+  if (!defenderWins.empty()) {
+    // The defender threatens five: only a four on the blocking cell keeps
+    // the initiative.
+    if (defenderWins.size() > 1) {
+      return false;
+    }
+    const Move block = defenderWins.front();
+    const bool blocks = std::find(fours.begin(), fours.end(), block) !=
+                        fours.end();
+    fours.assign(blocks ? 1 : 0, block);
+    threes.clear();
+  }
+
+  bool win = false;
+  for (const auto *moves : {&fours, &threes}) {
+    for (const auto &move : *moves) {
+      state_.play(move.first, move.second, attacker_);
+      std::vector<Move> &rest = lists.rest;
+      rest.clear();
+      win = defend(depth - 1, move, rest);
+      state_.undo();
+      if (win) {
+        line.assign(1, move);
+        line.insert(line.end(), rest.begin(), rest.end());
+        break;
+      }
+      if (aborted_) {
+        return false;
+      }
+    }
+    if (win) {
+      break;
+    }
+  }
+
+  if (!win && !aborted_) {
+    entry = {key, depth};
+  }
+  return win;
+}
+
+// Defender to move after the attacker's `threat`: true when every reply
+// still loses. `line` receives the first reply and the attack that beats it.
+bool ThreatSolver::defend(int depth, Move threat, std::vector<Move> &line) {
+  if (outOfBudget()) {
+    return false;
+  }
+
+  Ply &lists = ply();
+  std::vector<Move> &defenderWins = lists.wins;
+  collectWins(defender_, defenderWins);
+  if (!defenderWins.empty()) {
+    return false;
+  }
+
+  std::vector<Move> &replies = lists.fours;
+  collectWins(attacker_, replies);
+  if (replies.size() > 1) {
+    line.assign(1, replies.front());
+    return true;
+  }
+  if (replies.empty()) {
+    // A three: block anywhere on its line, or counter with a four.
+    for (int dir = 0; dir < GameState::kDirectionCount; ++dir) {
+      const int dx = GameState::kDirections[dir][0];
+      const int dy = GameState::kDirections[dir][1];
+      for (int step = -kThreatReach; step <= kThreatReach; ++step) {
+        const int x = threat.first + step * dx;
+        const int y = threat.second + step * dy;
+        if (step != 0 && state_.isValid(x, y) && state_.isEmpty(x, y)) {
+          replies.emplace_back(x, y);
+        }
+      }
+    }
+    for (const auto &move : state_.getLegalMoves()) {
+      if (makesFour(move, defender_) &&
+          std::find(replies.begin(), replies.end(), move) == replies.end()) {
+        replies.push_back(move);
+      }
+    }
+  }
+
+  bool first = true;
+  for (const auto &reply : replies) {
+    if (!(*legal_)(state_, reply.first, reply.second, defender_)) {
+      continue;
+    }
+    state_.play(reply.first, reply.second, defender_);
+    std::vector<Move> &rest = lists.rest;
+    rest.clear();
+    const bool win = attack(depth, rest);
+    state_.undo();
+    if (!win) {
+      return false;
+    }
+    if (first) {
+      line.assign(1, reply);
+      line.insert(line.end(), rest.begin(), rest.end());
+      first = false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,53 @@
+#include "TimeManager.hpp"
+
+#include <algorithm>
+
+namespace {
+using std::chrono::milliseconds;
+
+// Kept back from every limit for process and protocol overhead.
+constexpr milliseconds kSafetyMargin{50};
+// A game rarely lasts more than this many of our moves; near the end we
+// still plan for at least kMinMovesToGo more.
+constexpr int kExpectedMoves = 40;
+constexpr int kMinMovesToGo = 10;
+// No single move may use more than this fraction of the match time left.
+constexpr int kMaxShareDivisor = 4;
+
+milliseconds withoutMargin(milliseconds limit) {
+  return limit > kSafetyMargin ? limit - kSafetyMargin : milliseconds(1);
+}
+} // namespace
+
+TimeManager::Budget TimeManager::allocate(const Control &control, int stones) {
+  const milliseconds turnLimit = withoutMargin(control.turn);
+  if (control.match.count() <= 0 && control.left.count() < 0)
+    return {turnLimit, turnLimit};
+
+  const milliseconds left = withoutMargin(
+      control.left.count() >= 0 ? control.left : control.match);
+  const int movesToGo =
+      std::clamp(kExpectedMoves - stones / 2, kMinMovesToGo, kExpectedMoves);
+
+  const milliseconds maximum =
+      std::max(std::min(turnLimit, left / kMaxShareDivisor), milliseconds(1));
+  const milliseconds optimum = std::min(left / movesToGo, maximum);
+  return {std::max(optimum, milliseconds(1)), maximum};
+}
+
+void TimeManager::start(Budget budget) {
+  budget.maximum = std::max(budget.maximum, milliseconds(0));
+  budget.optimum = std::clamp(budget.optimum, milliseconds(0), budget.maximum);
+  start_ = Clock::now();
+  deadline_ = start_ + budget.maximum;
+  baseOptimum_ = budget.optimum;
+  optimum_ = budget.optimum;
+  maximum_ = budget.maximum;
+  stopped_.store(false, std::memory_order_relaxed);
+}
+
+void TimeManager::scaleOptimum(double factor) {
+  const auto scaled = milliseconds(static_cast<long long>(
+      static_cast<double>(baseOptimum_.count()) * factor));
+  optimum_ = std::min(scaled, maximum_);
+}
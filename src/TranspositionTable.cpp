@@ -0,0 +1,153 @@
+#include "TranspositionTable.hpp"
+
+#include <algorithm>
+
+namespace {
+// Layout of Slot::data, low to high bits: score (32), move (16),
+// depth (8), bound (2), generation (6).
+constexpr int kMoveShift = 32;
+constexpr int kDepthShift = 48;
+constexpr int kBoundShift = 56;
+constexpr int kGenerationShift = 58;
+constexpr std::uint8_t kGenerationMask = 0x3F;
+constexpr std::uint64_t kNoMove = 0xFFFF;
+
+// Penalty, in plies, for each search an entry has survived.
+constexpr int kAgeWeight = 4;
+
+int slotDepth(std::uint64_t data) {
+  return static_cast<int>((data >> kDepthShift) & 0xFF);
+}
+
+TranspositionTable::Bound slotBound(std::uint64_t data) {
+  return static_cast<TranspositionTable::Bound>((data >> kBoundShift) & 0x3);
+}
+
+// Relaxed ordering is enough: the XOR check rejects torn slots.
+std::uint64_t load(const std::atomic<std::uint64_t> &word) {
+  return word.load(std::memory_order_relaxed);
+}
+
+void save(std::atomic<std::uint64_t> &word, std::uint64_t value) {
+  word.store(value, std::memory_order_relaxed);
+}
+
+TranspositionTable::Move slotMove(std::uint64_t data) {
+  const std::uint64_t move = (data >> kMoveShift) & 0xFFFF;
+  if (move == kNoMove) {
+    return {-1, -1};
+  }
+  return {static_cast<int>(move >> 8), static_cast<int>(move & 0xFF)};
+}
+} // namespace
+
+TranspositionTable::TranspositionTable() { resize(kDefaultSizeMb << 20); }
+
+void TranspositionTable::resize(std::size_t bytes) {
+  std::size_t count = 1;
+  while (count * 2 * sizeof(Bucket) <= bytes) {
+    count *= 2;
+  }
+  if (count != bucketCount_) {
+    buckets_ = std::make_unique<Bucket[]>(count);
+    bucketCount_ = count;
+    mask_ = count - 1;
+  }
+  clear();
+}
+
+void TranspositionTable::clear() {
+  for (std::size_t i = 0; i < bucketCount_; ++i) {
+    for (Slot &slot : buckets_[i].slots) {
+      save(slot.check, 0);
+      save(slot.data, 0);
+    }
+  }
+  generation_ = 0;
+}
+
+void TranspositionTable::newSearch() {
+  generation_ = static_cast<std::uint8_t>((generation_ + 1) & kGenerationMask);
+}
+
+std::size_t TranspositionTable::sizeBytes() const {
+  return bucketCount_ * sizeof(Bucket);
+}
+
+std::uint64_t TranspositionTable::pack(int depth, int score, Bound bound,
+                                       Move move) const {
+  const bool hasMove = move.first >= 0 && move.second >= 0;
+  const std::uint64_t packedMove =
+      hasMove ? (static_cast<std::uint64_t>(move.first & 0xFF) << 8) |
+                    static_cast<std::uint64_t>(move.second & 0xFF)
+              : kNoMove;
+  return static_cast<std::uint64_t>(static_cast<std::uint32_t>(score)) |
+         (packedMove << kMoveShift) |
+         (static_cast<std::uint64_t>(std::clamp(depth, 0, 0xFF))
+          << kDepthShift) |
+         (static_cast<std::uint64_t>(bound) << kBoundShift) |
+         (static_cast<std::uint64_t>(generation_) << kGenerationShift);
+}
+
+int TranspositionTable::age(std::uint64_t data) const {
+  const auto stored =
+      static_cast<std::uint8_t>((data >> kGenerationShift) & kGenerationMask);
+  return (generation_ - stored) & kGenerationMask;
+}
+
+bool TranspositionTable::probe(std::uint64_t key, Entry &entry) const {
+  const Bucket &bucket = buckets_[key & mask_];
+  for (const Slot &slot : bucket.slots) {
+    const std::uint64_t data = load(slot.data);
+    if ((load(slot.check) ^ data) != key || slotBound(data) == Bound::None) {
+      continue;
+    }
+    entry.score = static_cast<std::int32_t>(data & 0xFFFFFFFF);
+    entry.depth = slotDepth(data);
+    entry.bound = slotBound(data);
+    entry.move = slotMove(data);
+    return true;
+  }
+  return false;
+}
+
+void TranspositionTable::store(std::uint64_t key, int depth, int score,
+                               Bound bound, Move move) {
+  Bucket &bucket = buckets_[key & mask_];
+
+  Slot *victim = nullptr;
+  int victimValue = 0;
+  for (int i = 0; i < kBucketSlots; ++i) {
+    Slot &slot = bucket.slots[i];
+    const std::uint64_t data = load(slot.data);
+    if ((load(slot.check) ^ data) == key && slotBound(data) != Bound::None) {
+      // Keep a deeper result from this search unless the new one is exact.
+      if (bound != Bound::Exact && age(data) == 0 && slotDepth(data) > depth) {
+        return;
+      }
+      if (move.first < 0) {
+        move = slotMove(data);
+      }
+      victim = &slot;
+      victimValue = -1;
+      break;
+    }
+    if (i == kBucketSlots - 1) {
+      break;
+    }
+    const int value = slotBound(data) == Bound::None
+                          ? -1
+                          : slotDepth(data) - kAgeWeight * age(data);
+    if (!victim || value < victimValue) {
+      victim = &slot;
+      victimValue = value;
+    }
+  }
+  if (victimValue > depth) {
+    victim = &bucket.slots[kBucketSlots - 1];
+  }
+
+  const std::uint64_t data = pack(depth, score, bound, move);
+  save(victim->check, key ^ data);
+  save(victim->data, data);
+}
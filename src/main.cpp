@@ -1,3 +1,6 @@
+#include "Analysis.hpp"
+#include "Bench.hpp"
+#include "BookBuilder.hpp"
 #include "Bot.hpp"
 #include "CommandRouter.hpp"
 #include "Logger.hpp"
@@ -89,12 +92,70 @@ static void configureLoggerFromEnvAndArgs(int argc, char **argv) {
   }
 }
 
+static bool hasArg(int argc, char **argv, const std::string &flag) {
+  for (int i = 1; i < argc; ++i) {
+    if (flag == argv[i])
+      return true;
+  }
+  return false;
+}
+
+static void configureBotFromArgs(Bot &bot, int argc, char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if (arg == "--hash" && i + 1 < argc) {
+      try {
+        bot.setHashSizeMb(std::stoi(argv[i + 1]));
+      } catch (...) {
+      }
+      ++i;
+      continue;
+    }
+    if (arg == "--report" && i + 1 < argc) {
+      const std::string target = toUpper(argv[i + 1]);
+      if (target == "MESSAGE")
+        bot.setSearchReport(Bot::SearchReport::Message);
+      else if (target == "DEBUG")
+        bot.setSearchReport(Bot::SearchReport::Debug);
+      ++i;
+      continue;
+    }
+    if (arg == "--book" && i + 1 < argc) {
+      bot.setBookPath(argv[i + 1]);
+      ++i;
+      continue;
+    }
+    if (arg == "--symmetry") {
+      bot.setSymmetricHashing(true);
+      continue;
+    }
+    if (arg == "--ponder") {
+      bot.setPondering(true);
+      continue;
+    }
+    if (arg == "--threads" && i + 1 < argc) {
+      try {
+        bot.setThreadCount(std::stoi(argv[i + 1]));
+      } catch (...) {
+      }
+      ++i;
+      continue;
+    }
+  }
+}
 
 int main(int argc, char **argv) {
   std::cout.setf(std::ios::unitbuf);
   configureLoggerFromEnvAndArgs(argc, argv);
+  if (hasArg(argc, argv, "--bench"))
+    return Bench::run(Bench::parseArgs(argc, argv));
+  if (hasArg(argc, argv, "--build-book"))
+    return BookBuilder::run(BookBuilder::parseArgs(argc, argv));
+  if (hasArg(argc, argv, "--solve") || hasArg(argc, argv, "--analyze"))
+    return Analysis::run(Analysis::parseArgs(argc, argv));
 
   Bot bot;
+  configureBotFromArgs(bot, argc, argv);
   CommandRouter router;
   bool running = true;
 
@@ -142,6 +203,43 @@ int main(int argc, char **argv) {
       bot.setTimeoutTurnMs(ms);
       return;
     }
+    if (upperKey == "TIMEOUT_MATCH" || upperKey == "TIME_LEFT") {
+      long long ms = 0;
+      try {
+        ms = std::stoll(value);
+      } catch (...) {
+        return;
+      }
+      if (upperKey == "TIMEOUT_MATCH")
+        bot.setTimeoutMatchMs(ms);
+      else
+        bot.setTimeLeftMs(ms);
+      return;
+    }
+    if (upperKey == "THREAD_NUM") {
+      int count = 0;
+      try {
+        count = std::stoi(value);
+      } catch (...) {
+        return;
+      }
+      bot.setThreadCount(count);
+      return;
+    }
+    if (upperKey == "PONDER") {
+      bot.setPondering(truthyEnv(value.c_str()));
+      return;
+    }
+    if (upperKey == "MAX_MEMORY") {
+      long long bytes = 0;
+      try {
+        bytes = std::stoll(value);
+      } catch (...) {
+        return;
+      }
+      bot.setMaxMemory(bytes);
+      return;
+    }
   });
 
   router.registerHandler("START", [&](const std::string &args) {
@@ -175,6 +273,7 @@ int main(int argc, char **argv) {
       return;
     }
     Response::move(*move);
+    bot.startPondering();
   });
 
   router.registerHandler("TURN", [&](const std::string &args) {
@@ -190,6 +289,7 @@ int main(int argc, char **argv) {
       return;
     }
     Response::move(*move);
+    bot.startPondering();
   });
 
   router.registerHandler("BOARD", [&](const std::string &) {
@@ -215,6 +315,7 @@ int main(int argc, char **argv) {
         return;
       }
     }
+    bot.finishBoard();
 
     {
       const auto move = bot.chooseMove();
@@ -223,11 +324,16 @@ int main(int argc, char **argv) {
         return;
       }
       Response::move(*move);
+      bot.startPondering();
     }
   });
 
   std::string line;
   while (running && std::getline(std::cin, line)) {
+    if (trim(line).empty())
+      continue;
+    // Every command may touch the board or the table: stop pondering first.
+    bot.stopPondering();
     router.process(line);
   }
 
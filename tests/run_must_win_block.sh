@@ -101,6 +101,30 @@ for file in "$TEST_DIR"/*.pos; do
 
 done
 
+# The same positions read by the engine's own .pos parser (--analyze);
+# every result line must report "expected":true.
+echo ""
+echo -e "${YELLOW}--- --analyze ---${NC}"
+analyzed=0
+while IFS= read -r result; do
+  [ -n "$result" ] || continue
+  analyzed=$((analyzed + 1))
+  file=$(echo "$result" | sed -n 's/^{"file":"\([^"]*\)".*/\1/p')
+  if [[ "$result" == *'"expected":true'* ]]; then
+    passed=$((passed + 1))
+    echo -e "${GREEN}✓ PASS${NC}: $(basename "$file") (--analyze)"
+  else
+    failed=$((failed + 1))
+    echo -e "${RED}✗ FAIL${NC}: $(basename "$file") (--analyze)"
+    echo "  Got: $result"
+  fi
+done < <("$BINARY" --analyze "$TEST_DIR" 2>/dev/null)
+
+if [ "$analyzed" -ne "$total" ]; then
+  failed=$((failed + 1))
+  echo -e "${RED}✗ FAIL${NC}: --analyze reported $analyzed of $total positions"
+fi
+
 echo ""
 echo -e "${YELLOW}=== Results ===${NC}"
 echo "Passed: $passed"
@@ -102,6 +102,29 @@ test_forbidden_avoid() {
 
 test_forbidden_avoid "START 20\nINFO rule 2\nBOARD\n0,0,1\n1,0,1\n2,0,1\n3,0,1\n4,0,1\n10,10,2\n11,10,2\n12,10,2\n13,10,2\n14,10,2\nDONE\nEND" "5,0" "Renju: bot avoids overline-forbidden move"
 
+# Test the reply to the last command, e.g. a TURN after a BOARD
+test_last_move() {
+    local input="$1"
+    local expected_pattern="$2"
+    local description="$3"
+
+    last_line=$(echo -e "$input" | "$BINARY" 2>/dev/null | tail -n 1)
+
+    if echo "$last_line" | grep -qE "$expected_pattern"; then
+        echo -e "${GREEN}✓ PASS${NC}: $description"
+        echo "  Output: $last_line"
+    else
+        echo -e "${RED}✗ FAIL${NC}: $description"
+        echo "  Expected pattern: $expected_pattern"
+        echo "  Got: $last_line"
+    fi
+    echo ""
+}
+
+# We moved second (the opponent has the extra stone): after TURN the bot
+# must still see the opponent's open four and block it.
+test_last_move "START 20\nINFO timeout_turn 1000\nBOARD\n9,10,1\n0,19,1\n2,19,1\n4,19,1\n19,0,1\n19,2,1\n10,10,2\n11,10,2\n12,10,2\n13,10,2\n5,4,2\n5,5,2\n5,6,2\nDONE\nTURN 5,7\nEND" "^(5,3|5,8)$" "BOARD as second player: TURN stone counted as the opponent's"
+
 # Test 5 seconds max per move (best-effort via `timeout`)
 if command -v timeout >/dev/null 2>&1; then
     if timeout 5 bash -c "echo -e 'START 20\nBEGIN\nEND' | \"$BINARY\" >/dev/null 2>/dev/null"; then
@@ -0,0 +1,351 @@
+/**
+ * Incremental State Tests for Gomoku
+ *
+ * This test file verifies the data GameState maintains incrementally
+ * across play/undo/set: the candidate move list used by the search and
+ * the line pattern scores used by the evaluation, the encoded windows
+ * classified by the shape lookup table, and the symmetry-canonical hash.
+ */
+
+#include "../include/GameState.hpp"
+#include "../include/Patterns.hpp"
+#include <iostream>
+#include <set>
+#include <string>
+
+// Test result counters
+int passed = 0;
+int failed = 0;
+
+void reportTest(const std::string& name, bool success) {
+    if (success) {
+        std::cout << "\033[32m✓ PASS\033[0m: " << name << std::endl;
+        passed++;
+    } else {
+        std::cout << "\033[31m✗ FAIL\033[0m: " << name << std::endl;
+        failed++;
+    }
+}
+
+// Reference move generator: every empty cell with a stone in its 5x5 box
+std::set<GameState::Move> scanCandidates(const GameState& game) {
+    std::set<GameState::Move> moves;
+    for (int y = 0; y < game.size(); ++y) {
+        for (int x = 0; x < game.size(); ++x) {
+            if (!game.isEmpty(x, y))
+                continue;
+            for (int dy = -2; dy <= 2; ++dy) {
+                for (int dx = -2; dx <= 2; ++dx) {
+                    if ((dx || dy) && game.isValid(x + dx, y + dy) &&
+                        !game.isEmpty(x + dx, y + dy))
+                        moves.insert({x, y});
+                }
+            }
+        }
+    }
+    return moves;
+}
+
+bool matchesScan(const GameState& game) {
+    const auto& moves = game.getLegalMoves();
+    std::set<GameState::Move> unique(moves.begin(), moves.end());
+    return unique.size() == moves.size() && unique == scanCandidates(game);
+}
+
+// Test 1: Empty board proposes the centre only
+void testEmptyBoardCentre() {
+    GameState game(20);
+    const auto& moves = game.getLegalMoves();
+    bool ok = moves.size() == 1 && moves[0] == GameState::Move(10, 10);
+    reportTest("Empty board returns the centre move", ok);
+}
+
+// Test 2: Candidates follow stones placed with play()
+void testCandidatesAfterPlay() {
+    GameState game(20);
+    game.play(10, 10, GameState::Player::One);
+    game.play(0, 0, GameState::Player::Two);
+    game.play(12, 11, GameState::Player::One);
+
+    reportTest("Candidates match a full-board scan after play()", matchesScan(game));
+}
+
+// Test 3: Undo restores the exact candidate order
+void testUndoRestoresOrder() {
+    GameState game(20);
+    game.play(10, 10, GameState::Player::One);
+    game.play(11, 11, GameState::Player::Two);
+    const std::vector<GameState::Move> before = game.getLegalMoves();
+
+    game.play(9, 10, GameState::Player::One);
+    game.play(8, 8, GameState::Player::Two);
+    game.undo();
+    game.undo();
+
+    reportTest("Undo restores the candidate list in the same order",
+               game.getLegalMoves() == before);
+}
+
+// Test 4: set() keeps candidates consistent, including removals
+void testCandidatesAfterSet() {
+    GameState game(20);
+    game.set(19, 19, GameState::Player::One);
+    game.set(18, 17, GameState::Player::Two);
+    game.set(5, 5, GameState::Player::One);
+    game.set(19, 19, GameState::Player::None);
+
+    reportTest("Candidates match a full-board scan after set()", matchesScan(game));
+}
+
+// Pattern score of a single horizontal shape for Player One, '.' = empty
+int shapeScore(const std::string& shape) {
+    GameState game(20);
+    for (std::size_t i = 0; i < shape.size(); ++i) {
+        if (shape[i] == 'X')
+            game.set(static_cast<int>(i) + 3, 10, GameState::Player::One);
+        else if (shape[i] == 'O')
+            game.set(static_cast<int>(i) + 3, 10, GameState::Player::Two);
+    }
+    return game.patternScore(GameState::Player::One);
+}
+
+// Test 5: Incremental scores match a position rebuilt from scratch
+void testPatternScoreIncremental() {
+    GameState game(20);
+    const GameState::Move moves[] = {{10, 10}, {11, 11}, {10, 11}, {9, 12},
+                                     {10, 12}, {10, 9},  {12, 12}, {11, 10}};
+    for (std::size_t i = 0; i < sizeof(moves) / sizeof(moves[0]); ++i)
+        game.play(moves[i].first, moves[i].second, game.currentPlayer());
+    game.undo();
+    game.undo();
+
+    GameState rebuilt(20);
+    for (std::size_t i = 0; i + 2 < sizeof(moves) / sizeof(moves[0]); ++i)
+        rebuilt.set(moves[i].first, moves[i].second,
+                    i % 2 == 0 ? GameState::Player::One : GameState::Player::Two);
+
+    bool same = game.patternScore(GameState::Player::One) ==
+                    rebuilt.patternScore(GameState::Player::One) &&
+                game.patternScore(GameState::Player::Two) ==
+                    rebuilt.patternScore(GameState::Player::Two);
+    game.clear();
+    bool cleared = game.patternScore(GameState::Player::One) == 0 &&
+                   game.patternScore(GameState::Player::Two) == 0;
+    reportTest("Incremental pattern scores survive undo and clear", same && cleared);
+}
+
+// Test 6: Open shapes outscore closed ones, broken threes count as threes
+void testPatternShapes() {
+    bool openBeatsClosed = shapeScore("..XXX..") > shapeScore("OXXX...") &&
+                           shapeScore(".XXXX.") > shapeScore("OXXXX.");
+    bool brokenThree = shapeScore(".X.XX.") > shapeScore("..XX..") &&
+                       shapeScore("X.XXX") >= shapeScore("OXXXX.");
+    reportTest("Open, closed and broken shapes are ranked sensibly",
+               openBeatsClosed && brokenThree);
+}
+
+// Test 7: Shape table classifies windows read from the bitboards
+void testShapeWindows() {
+    GameState game(20);
+    // Row 10: . X X [ ] X . -> playing the gap makes an open four
+    game.set(8, 10, GameState::Player::One);
+    game.set(9, 10, GameState::Player::One);
+    game.set(11, 10, GameState::Player::One);
+    // Column 0 against the top edge: [ ] X X X . -> a four, not open
+    game.set(0, 1, GameState::Player::Two);
+    game.set(0, 2, GameState::Player::Two);
+    game.set(0, 3, GameState::Player::Two);
+
+    auto shape = [&](int dir, int x, int y, GameState::Player player) {
+        return Patterns::shape(game.shapeWindow(dir, x, y, player));
+    };
+    bool openFour = (shape(0, 10, 10, GameState::Player::One) &
+                     (Patterns::kOpenFour | Patterns::kFour)) ==
+                    (Patterns::kOpenFour | Patterns::kFour);
+    std::uint8_t edge = shape(1, 0, 0, GameState::Player::Two);
+    bool edgeFour = (edge & Patterns::kFour) && !(edge & Patterns::kOpenFour);
+    // . [ ] X X . X . -> both a broken four and the free three .XXX.
+    bool freeThree = shape(0, 7, 10, GameState::Player::One) ==
+                         (Patterns::kFour | Patterns::kFreeThree) &&
+                     shape(0, 12, 10, GameState::Player::Two) == 0;
+    reportTest("Shape table flags open fours, edge fours and threes", openFour && edgeFour && freeThree);
+}
+
+// Test 8: Symmetric positions share one canonical hash
+void testCanonicalHash() {
+    const GameState::Move stones[] = {{9, 9}, {10, 9}, {10, 11}, {7, 8}};
+    GameState base(20);
+    for (int i = 0; i < 4; ++i) {
+        base.set(stones[i].first, stones[i].second,
+                 i % 2 ? GameState::Player::Two : GameState::Player::One);
+    }
+
+    bool sameKey = true;
+    bool inverse = true;
+    for (int sym = 0; sym < GameState::kSymmetryCount; ++sym) {
+        GameState image(20);
+        for (int i = 0; i < 4; ++i) {
+            const GameState::Move cell = base.transform(sym, stones[i]);
+            image.set(cell.first, cell.second,
+                      i % 2 ? GameState::Player::Two : GameState::Player::One);
+        }
+        sameKey = sameKey && image.canonicalHash() == base.canonicalHash();
+        const GameState::Move back = base.transform(
+            GameState::inverseSymmetry(sym), base.transform(sym, {3, 14}));
+        inverse = inverse && back == GameState::Move{3, 14};
+    }
+    reportTest("Canonical hash ignores rotations and reflections", sameKey && inverse);
+}
+
+// Test 9: Incrementally tracked symmetry hashes match a full rescan
+void testTrackedSymmetries() {
+    GameState tracked(20);
+    GameState scanned(20);
+    tracked.set(3, 4, GameState::Player::Two);
+    scanned.set(3, 4, GameState::Player::Two);
+    tracked.trackSymmetries(true);
+
+    const GameState::Move moves[] = {{9, 9}, {10, 10}, {0, 19}, {12, 7}, {5, 6}};
+    bool matches = true;
+    auto check = [&] {
+        int trackedSym = -1;
+        int scannedSym = -1;
+        matches = matches &&
+                  tracked.canonicalHash(&trackedSym) ==
+                      scanned.canonicalHash(&scannedSym) &&
+                  trackedSym == scannedSym;
+    };
+    for (int i = 0; i < 5; ++i) {
+        const auto player = i % 2 ? GameState::Player::Two : GameState::Player::One;
+        tracked.play(moves[i].first, moves[i].second, player);
+        scanned.play(moves[i].first, moves[i].second, player);
+        check();
+    }
+    for (int i = 0; i < 3; ++i) {
+        tracked.undo();
+        scanned.undo();
+        check();
+    }
+    tracked.set(3, 4, GameState::Player::None);
+    scanned.set(3, 4, GameState::Player::None);
+    check();
+    reportTest("Tracked symmetry hashes follow play, undo and set", matches);
+}
+
+// Test 10: a position set up with set() keeps alternating when played on
+void testSideToMoveAfterSet() {
+    GameState game(20);
+    game.set(9, 9, GameState::Player::One);
+    game.set(10, 10, GameState::Player::Two);
+    game.set(9, 10, GameState::Player::One);
+    bool ok = game.currentPlayer() == GameState::Player::Two;
+    game.play(11, 11, GameState::Player::Two);
+    ok = ok && game.currentPlayer() == GameState::Player::One;
+    game.play(9, 11, GameState::Player::One);
+    ok = ok && game.currentPlayer() == GameState::Player::Two;
+    game.undo();
+    game.undo();
+    ok = ok && game.currentPlayer() == GameState::Player::Two;
+    reportTest("Side to move alternates on a position built with set()", ok);
+}
+
+// Test 11: other board sizes are honoured, edges included
+void testOtherBoardSizes() {
+    bool ok = true;
+    for (int size : {15, 19, 20}) {
+        GameState game(size);
+        ok = ok && game.size() == size && game.isValid(size - 1, size - 1) &&
+             !game.isValid(size, 0) && game.getLegalMoves().size() == 1 &&
+             game.getLegalMoves()[0] == GameState::Move(size / 2, size / 2);
+        const GameState::Move moves[] = {
+            {0, 0}, {size - 1, size - 1}, {size - 1, 0}, {size / 2, 1}};
+        for (const auto& [x, y] : moves) {
+            game.play(x, y, game.currentPlayer());
+            ok = ok && matchesScan(game);
+        }
+        for (int y = 0; y < 4; ++y)
+            game.set(size - 1, size - 2 - y, GameState::Player::One);
+        ok = ok && game.willWin(size - 1, size - 6, GameState::Player::One);
+        game.clear();
+        ok = ok && game.stoneCount() == 0 &&
+             game.getLegalMoves().size() == 1;
+    }
+    ok = ok && GameState(200).size() == GameState::kMaxSize;
+    reportTest("15x15, 19x19 and 20x20 boards track candidates to the edge",
+               ok);
+}
+
+// Test 12: a BOARD where we moved second: the opponent's stones become
+// Player One, so the side to move still alternates after swapColours()
+void testSecondPlayerSetUp() {
+    GameState game(20);
+    const GameState::Move ours[] = {{5, 5}, {6, 5}, {7, 5}};
+    const GameState::Move theirs[] = {{4, 5}, {15, 15}, {15, 17}, {17, 15}};
+    for (const auto& [x, y] : ours)
+        game.set(x, y, GameState::Player::One);
+    for (const auto& [x, y] : theirs)
+        game.set(x, y, GameState::Player::Two);
+    game.swapColours();
+    bool ok = game.stoneCount(GameState::Player::One) == 4 &&
+              game.stoneCount(GameState::Player::Two) == 3 &&
+              game.playerAt(4, 5) == GameState::Player::One &&
+              game.playerAt(6, 5) == GameState::Player::Two &&
+              game.currentPlayer() == GameState::Player::Two &&
+              matchesScan(game);
+    game.play(8, 5, GameState::Player::Two);
+    ok = ok && game.currentPlayer() == GameState::Player::One;
+    game.play(9, 5, GameState::Player::One);
+    ok = ok && game.currentPlayer() == GameState::Player::Two &&
+         matchesScan(game);
+    reportTest("Second-player set-up swaps colours and keeps alternating", ok);
+}
+
+// Test 13: on the widest board the cells past the last column are walls,
+// even where a line uses bit 63 of its mask
+void testMaxBoardSize() {
+    const int last = GameState::kMaxSize - 1;
+    GameState game(GameState::kMaxSize);
+    // Row 0 against the right edge: . X X X [ ] | -> a four, not open
+    for (int x = last - 3; x < last; ++x)
+        game.set(x, 0, GameState::Player::One);
+    const std::uint8_t edge =
+        Patterns::shape(game.shapeWindow(0, last, 0, GameState::Player::One));
+    bool ok = (edge & Patterns::kFour) && !(edge & Patterns::kOpenFour);
+    std::uint32_t own = 0;
+    std::uint32_t blocked = 0;
+    game.lineWindow(0, last, 0, GameState::Player::One, 5, own, blocked);
+    ok = ok && own == 0x1C && blocked == 0x3E0;
+    game.play(last, last, game.currentPlayer());
+    ok = ok && matchesScan(game);
+    reportTest("Cells past the edge of a 64x64 board stay blocked", ok);
+}
+
+int main() {
+    std::cout << "\033[33m=== Gomoku Incremental State Tests ===\033[0m\n" << std::endl;
+
+    testEmptyBoardCentre();
+    testCandidatesAfterPlay();
+    testUndoRestoresOrder();
+    testCandidatesAfterSet();
+    testPatternScoreIncremental();
+    testPatternShapes();
+    testShapeWindows();
+    testCanonicalHash();
+    testTrackedSymmetries();
+    testSideToMoveAfterSet();
+    testOtherBoardSizes();
+    testSecondPlayerSetUp();
+    testMaxBoardSize();
+
+    std::cout << "\n\033[33m=== Results ===\033[0m" << std::endl;
+    std::cout << "Passed: " << passed << std::endl;
+    std::cout << "Failed: " << failed << std::endl;
+
+    if (failed == 0) {
+        std::cout << "\n\033[32m✓ All tests passed!\033[0m" << std::endl;
+        return 0;
+    } else {
+        std::cout << "\n\033[31m✗ Some tests failed!\033[0m" << std::endl;
+        return 1;
+    }
+}
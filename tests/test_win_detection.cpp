@@ -2,11 +2,16 @@
  * Win Detection Tests for Gomoku (C2 - Five in a row)
  * 
  * This test file verifies the checkWin functionality that detects
- * five consecutive pieces in rows, columns, and diagonals.
+ * five consecutive pieces in rows, columns, and diagonals, and the Renju
+ * forbidden moves (overline, double four, double three) for Player One.
  */
 
 #include "../include/GameState.hpp"
+#include "../include/ProofSolver.hpp"
+#include "../include/Renju.hpp"
+#include "../include/ThreatSolver.hpp"
 #include <iostream>
+#include <random>
 #include <string>
 #include <cassert>
 
@@ -241,6 +246,169 @@ void testEmptyCellNoWin() {
     reportTest("Empty cell correctly returns no win", noWin);
 }
 
+// Test 16: Undo removes the winning stone from every line
+void testUndoClearsWin() {
+    GameState game(20);
+
+    // Alternate moves so Player One builds an anti-diagonal five
+    for (int i = 0; i < 5; ++i) {
+        game.play(4 + i, 12 - i, GameState::Player::One);
+        if (i < 4) {
+            game.play(0, i, GameState::Player::Two);
+        }
+    }
+
+    bool winBefore = game.checkWinFor(GameState::Player::One);
+    game.undo();
+    bool noWinAfter = !game.checkWinFor(GameState::Player::One) &&
+                      !game.checkWin(7, 9) && game.willWin(8, 8, GameState::Player::One);
+
+    reportTest("Undo clears win and restores winning threat", winBefore && noWinAfter);
+}
+
+void placeBlack(GameState& game, std::initializer_list<GameState::Move> stones) {
+    for (const auto& stone : stones) {
+        game.set(stone.first, stone.second, GameState::Player::One);
+    }
+}
+
+// Test 17: Overline and double four are forbidden, exactly five is not
+void testRenjuOverlineAndDoubleFour() {
+    GameState overline(20);
+    placeBlack(overline, {{4, 10}, {5, 10}, {6, 10}, {8, 10}, {9, 10}});
+    GameState five(20);
+    placeBlack(five, {{5, 10}, {6, 10}, {8, 10}, {9, 10}});
+    // X.XXX.X along one line makes two fours at once
+    GameState doubleFour(20);
+    placeBlack(doubleFour, {{3, 10}, {5, 10}, {7, 10}, {9, 10}});
+
+    reportTest("Renju: overline and double four forbidden, five allowed",
+               Renju::isForbidden(overline, 7, 10) &&
+               !Renju::isForbidden(five, 7, 10) &&
+               Renju::isForbidden(doubleFour, 6, 10));
+}
+
+// Test 18: Only threes that can still become a straight four count
+void testRenjuDoubleThree() {
+    GameState open(20);
+    placeBlack(open, {{9, 10}, {11, 10}, {10, 9}, {10, 11}});
+
+    // White caps the vertical three: one open three is left
+    GameState capped = open;
+    capped.set(10, 8, GameState::Player::Two);
+    capped.set(10, 13, GameState::Player::Two);
+
+    // Both straight-four points of the horizontal three are overlines
+    GameState fake = open;
+    placeBlack(fake, {{8, 7}, {8, 8}, {8, 9}, {8, 11}, {8, 12},
+                      {12, 7}, {12, 8}, {12, 9}, {12, 11}, {12, 12}});
+
+    reportTest("Renju: double three forbidden unless a three is dead or fake",
+               Renju::isForbidden(open, 10, 10) &&
+               !Renju::isForbidden(capped, 10, 10) &&
+               !Renju::isForbidden(fake, 10, 10));
+}
+
+// Test 19: The forbidden cache follows play and undo
+void testRenjuCache() {
+    GameState game(20);
+    game.trackForbidden(true);
+    placeBlack(game, {{9, 10}, {11, 10}, {10, 9}});
+    bool legalBefore = !Renju::isForbidden(game, 10, 10);
+    game.play(10, 11, GameState::Player::One);
+    bool forbidden = Renju::isForbidden(game, 10, 10);
+    game.undo();
+    bool legalAfter = !Renju::isForbidden(game, 10, 10);
+
+    reportTest("Renju: cached verdicts are reset by play and undo",
+               legalBefore && forbidden && legalAfter);
+}
+
+// Test 20: The whole-board scan agrees with checkWin() on every stone
+void testWholeBoardScan() {
+    std::mt19937 rng(20);
+    bool agree = true;
+    int wins = 0;
+    for (int size : {7, 15, 20}) {
+        for (int round = 0; round < 200; ++round) {
+            GameState game(size);
+            std::uniform_int_distribution<int> cell(0, size - 1);
+            const int stones = size * size / 3;
+            for (int i = 0; i < stones; ++i) {
+                game.set(cell(rng), cell(rng),
+                         i % 2 ? GameState::Player::Two
+                               : GameState::Player::One);
+            }
+            for (auto player : {GameState::Player::One,
+                                GameState::Player::Two}) {
+                bool expected = false;
+                for (int y = 0; y < size; ++y) {
+                    for (int x = 0; x < size; ++x) {
+                        expected = expected ||
+                                   (game.playerAt(x, y) == player &&
+                                    game.checkWin(x, y));
+                    }
+                }
+                agree = agree && game.checkWinFor(player) == expected;
+                wins += expected;
+            }
+        }
+    }
+    reportTest("checkWinFor() matches a per-stone scan on random boards",
+               agree && wins > 0);
+}
+
+// Test 21: A four whose only block is forbidden for black wins for white
+void testProofForbiddenBlock() {
+    GameState game(15);
+    game.trackForbidden(true);
+    // (6, 7) would give black a double three, so white's four at (6, 3)
+    // cannot be blocked
+    placeBlack(game, {{4, 7}, {5, 7}, {4, 5}, {5, 6}, {6, 2}, {6, 8}});
+    for (const auto& [x, y] : std::vector<GameState::Move>{
+             {6, 4}, {6, 5}, {6, 6}, {0, 14}, {14, 14}})
+        game.set(x, y, GameState::Player::Two);
+    const ProofSolver::LegalityCheck legal =
+        [](const GameState& state, int x, int y, GameState::Player player) {
+            return state.isEmpty(x, y) &&
+                   (player != GameState::Player::One ||
+                    !Renju::isForbidden(state, x, y));
+        };
+    ProofSolver solver(1 << 20);
+    TimeManager timer;
+    timer.start(std::chrono::milliseconds(10000));
+    const auto result = solver.solve(game, 100000, timer, legal);
+    reportTest("Proof solver: a four with a forbidden block wins for white",
+               Renju::isForbidden(game, 6, 7) &&
+               result.outcome == ProofSolver::Outcome::Win &&
+               result.line == std::vector<GameState::Move>{{6, 3}});
+}
+
+// Test 22: A three capped on both sides (O.XXX.O) is no VCT threat
+void testVctCappedThree() {
+    GameState game(15);
+    // (7, 7) only makes a capped three on row 7, so the defender does not
+    // have to answer it; there is no VCT here
+    for (const auto& [x, y] : std::vector<GameState::Move>{
+             {5, 7}, {6, 7}, {7, 6}, {4, 10}})
+        game.set(x, y, GameState::Player::One);
+    for (const auto& [x, y] : std::vector<GameState::Move>{
+             {3, 7}, {9, 7}, {6, 9}, {7, 4}})
+        game.set(x, y, GameState::Player::Two);
+    const ThreatSolver::LegalityCheck legal =
+        [](const GameState& state, int x, int y, GameState::Player) {
+            return state.isEmpty(x, y);
+        };
+    ThreatSolver solver;
+    TimeManager timer;
+    timer.start(std::chrono::milliseconds(10000));
+    const auto result = solver.solve(game, GameState::Player::One,
+                                     ThreatSolver::Mode::Vct, 4, 200000,
+                                     timer, legal);
+    reportTest("Threat solver: a capped three does not force a VCT win",
+               !result.proven);
+}
+
 int main() {
     std::cout << "\033[33m=== Gomoku Win Detection Tests (C2) ===\033[0m\n" << std::endl;
     
@@ -259,6 +427,13 @@ int main() {
     testBrokenLineNoWin();
     testMixedPlayersNoWin();
     testEmptyCellNoWin();
+    testUndoClearsWin();
+    testRenjuOverlineAndDoubleFour();
+    testRenjuDoubleThree();
+    testRenjuCache();
+    testWholeBoardScan();
+    testProofForbiddenBlock();
+    testVctCappedThree();
     
     std::cout << "\n\033[33m=== Results ===\033[0m" << std::endl;
     std::cout << "Passed: " << passed << std::endl;